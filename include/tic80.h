@@ -51,6 +51,32 @@ typedef enum {
     TIC80_PIXEL_COLOR_BGRA8888 = (4 << 8) | 32,
 } tic80_pixel_color_format;
 
+// the low byte is the bits per sample, like the pixel formats
+typedef enum {
+    TIC80_SOUND_FORMAT_S16 = (1 << 8) | 16,
+    TIC80_SOUND_FORMAT_F32 = (2 << 8) | 32,
+} tic80_sound_format;
+
+#define TIC80_SOUND_BYTES(format) (((format) & 0xff) / 8)
+
+typedef enum {
+    TIC80_PROFILE_IO,
+    TIC80_PROFILE_TICK,
+    TIC80_PROFILE_SCANLINE,
+    TIC80_PROFILE_OVERLINE,
+    TIC80_PROFILE_BLIT,
+    TIC80_PROFILE_SOUND,
+    TIC80_PROFILE_PHASES,
+} tic80_profile_phase;
+
+// time spent in a phase per frame, in microseconds
+typedef struct {
+    float last;
+    float min;
+    float avg;
+    float p99;
+} tic80_profile_stats;
+
 typedef struct {
     struct {
         void (*trace)(const char* text, u8 color);
@@ -58,8 +84,13 @@ typedef struct {
         void (*exit)();
     } callback;
 
+    // count interleaved samples of the last tick in the format given to
+    // tic80_create(), it varies by one frame when the rate isn't a multiple of 60
     struct {
-        s16* samples;
+        union {
+            s16* samples;
+            float* fsamples;
+        };
         s32 count;
     } sound;
 
@@ -128,9 +159,53 @@ typedef struct {
     tic80_keyboard keyboard;
 } tic80_input;
 
-TIC80_API tic80* tic80_create(s32 samplerate);
+// the sound is rendered at the device rate, format and channel count,
+// two channels are interleaved and one gets the left and right mixed
+TIC80_API tic80* tic80_create(s32 samplerate, tic80_sound_format format, s32 channels);
 TIC80_API void tic80_load(tic80* tic, void* cart, s32 size);
 TIC80_API void tic80_tick(tic80* tic, const tic80_input* input);
+
+// tic80_tick() split in two: run the game logic and sound without
+// converting the frame, then blit only the frames the host will present
+TIC80_API void tic80_update(tic80* tic, const tic80_input* input);
+TIC80_API void tic80_blit(tic80* tic);
+
+// save states: tic80_snapshot() fills a tic80_snapshot_size() bytes buffer
+// and tic80_restore() puts the machine back into that state.
+// NOTE: of the script only the plain values of its globals are saved (numbers,
+// strings, booleans and tables of them); functions, their upvalues and
+// metatables stay as they are. tic80_snapshot() fails if a global holds a
+// value that can't be saved, like a coroutine, or they take more than 64 KB.
+// NOTE: the audio synth restarts at the restored channel levels, so the
+// first few samples after a restore differ from the uninterrupted run.
+TIC80_API s32 tic80_snapshot_size();
+TIC80_API bool tic80_snapshot(tic80* tic, void* buffer);
+TIC80_API bool tic80_restore(tic80* tic, const void* buffer);
+
+// xor/rle delta between two snapshots, returns its size or -1 if it doesn't
+// fit in capacity; applying it to either snapshot gives the other one
+TIC80_API s32 tic80_snapshot_delta(const void* prev, const void* next, void* delta, s32 capacity);
+TIC80_API bool tic80_snapshot_apply(void* snapshot, const void* delta, s32 size);
+
+// input recording: while on, the input of every tick is kept as the loaded cart
+// hash plus per-frame input deltas, unchanged frames run length encoded; start it
+// right after tic80_load() to replay it later. tic80_recording() returns the size
+// of the recording so far and copies it to buffer if it fits in capacity, or -1
+// if recording stopped because it ran out of memory
+TIC80_API void tic80_record(tic80* tic, bool on);
+TIC80_API s32 tic80_recording(tic80* tic, void* buffer, s32 capacity);
+
+// replay: call right after tic80_load(), fails if the recording was made with
+// another cart; every tic80_replay_tick() runs the next recorded frame and returns
+// false when the recording is over. The recording must stay valid until then
+TIC80_API bool tic80_replay(tic80* tic, const void* recording, s32 size);
+TIC80_API bool tic80_replay_tick(tic80* tic, bool blit);
+
+// frame time profiler: while on, the time of every phase of a frame is measured,
+// tic80_profile_get() fills TIC80_PROFILE_PHASES stats over the recent frames
+TIC80_API void tic80_profile(tic80* tic, bool on);
+TIC80_API void tic80_profile_get(tic80* tic, tic80_profile_stats* stats);
+
 TIC80_API void tic80_delete(tic80* tic);
 
 #ifdef __cplusplus
@@ -31,6 +31,11 @@ typedef struct {
 } RemapResult;
 typedef void(*RemapFunc)(void*, s32 x, s32 y, RemapResult* result);
 
+// batched remap: one call with the visible cells of a map() call, the results
+// come prefilled with the map tiles, cell (i, j) is results[j * stride + i]
+// at map coords (x + i, y + j) wrapped around the map size
+typedef void(*RemapBatchFunc)(void*, s32 x, s32 y, s32 width, s32 height, RemapResult* results, s32 stride);
+
 typedef void(*TraceOutput)(void*, const char*, u8 color);
 typedef void(*ErrorOutput)(void*, const char*);
 typedef void(*ExitCallback)(void*);
@@ -70,9 +75,16 @@ typedef struct {
         tic_overline overline;
     };
 
-    const tic_outline_item* (*getOutline)(const char* code, s32* size);
+    // returned items are owned by the caller and released with free()
+    tic_outline_item* (*getOutline)(const char* code, s32* size);
     void (*eval)(tic_mem* tic, const char* code);
 
+    // save states: save() writes the script globals to buffer and returns their
+    // size, or -1 if they don't fit or hold values it can't store; load() puts
+    // them back into the running script and fails on data save() didn't write
+    s32 (*save)(tic_mem* memory, void* buffer, s32 capacity);
+    bool (*load)(tic_mem* memory, const void* buffer, s32 size);
+
     const char* blockCommentStart;
     const char* blockCommentEnd;
     const char* blockCommentStart2;
@@ -307,7 +319,7 @@ enum {
         9,                                                                                                              \
         void,                                                                                                           \
         tic_mem*, s32 x, s32 y, s32 width, s32 height, s32 sx, s32 sy,                                                  \
-        u8* colors, s32 count, s32 scale, RemapFunc remap, void* data)                                                  \
+        u8* colors, s32 count, s32 scale, RemapFunc remap, RemapBatchFunc batch, void* data)                            \
                                                                                                                         \
                                                                                                                         \
     macro(mget,                                                                                                         \
@@ -659,7 +671,11 @@ struct tic_mem {
     } input;
 
     struct {
-        s16* buffer;
+        union {
+            s16*   buffer;
+            float* fbuffer;
+        };
+        // bytes rendered by the last tick
         s32  size;
     } samples;
 
@@ -668,7 +684,7 @@ struct tic_mem {
     tic80_pixel_color_format screen_format;
 };
 
-tic_mem* tic_core_create(s32 samplerate);
+tic_mem* tic_core_create(s32 samplerate, tic80_sound_format format, s32 channels);
 void tic_core_close(tic_mem* memory);
 void tic_core_pause(tic_mem* memory);
 void tic_core_resume(tic_mem* memory);
@@ -677,6 +693,10 @@ void tic_core_tick(tic_mem* memory, tic_tick_data* data);
 void tic_core_tick_end(tic_mem* memory);
 void tic_core_blit(tic_mem* tic, tic80_pixel_color_format fmt);
 void tic_core_blit_ex(tic_mem* tic, tic80_pixel_color_format fmt, tic_scanline scanline, tic_overline overline, void* data);
+// call after writing RAM directly, outside of the poke/memcpy/sync api
+void tic_core_dirty_ram(tic_mem* memory, s32 address, s32 size);
+void tic_core_profile(tic_mem* memory, bool on);
+void tic_core_profile_stats(tic_mem* memory, tic80_profile_stats* stats);
 const tic_script_config* tic_core_script_config(tic_mem* memory);
 
 typedef struct {
@@ -684,4 +704,28 @@ typedef struct {
     tic_mem* memory;
     tic_tick_data tickData;
     u64 tick_counter;
+    u32 cart_hash;
+
+    // input stream being written, see tic80_record()
+    struct {
+        bool on;
+        bool failed;
+        u8* data;
+        s32 size;
+        s32 capacity;
+        u32 frames;
+        u32 same;
+        tic80_input last;
+    } record;
+
+    // recording being played back, see tic80_replay()
+    struct {
+        const u8* data;
+        s32 size;
+        s32 pos;
+        u32 same;
+        const u8* delta;
+        u32 deltaSize;
+        tic80_input input;
+    } replay;
 } tic80_local;  
@@ -34,6 +34,7 @@
 #define LUA_LOC_STACK 100000000
 
 static const char TicCore[] = "_TIC80";
+static const char TicBuiltins[] = "_TIC80_BUILTINS";
 
 //#41
 static s32 getLuaNumber(lua_State* lua, s32 index)
@@ -320,6 +321,25 @@ static void initAPI(tic_core* core)
   lua_sethook(core->lua, &checkForceExit, LUA_MASKCOUNT, LUA_LOC_STACK);
 }
 
+// the globals before the cart runs, save states leave them out
+static void saveBuiltins(lua_State* lua)
+{
+  lua_newtable(lua);
+  lua_pushglobaltable(lua);
+  lua_pushnil(lua);
+
+  while (lua_next(lua, -2))
+  {
+    lua_pop(lua, 1);
+    lua_pushvalue(lua, -1);
+    lua_pushboolean(lua, true);
+    lua_rawset(lua, -5);
+  }
+
+  lua_pop(lua, 1);
+  lua_setfield(lua, LUA_REGISTRYINDEX, TicBuiltins);
+}
+
 //#1376
 static void closeLua(tic_mem* tic)
 {
@@ -329,6 +349,7 @@ static void closeLua(tic_mem* tic)
   {
     lua_close(core->lua);
     core->lua = NULL;
+    core->scanlineRef = LUA_NOREF;
   }
 }
 
@@ -343,6 +364,7 @@ static bool initLua(tic_mem* tic, const char* code)
   lua_open_builtins(lua);
 
   initAPI(core);
+  saveBuiltins(lua);
 
   {
     lua_State* lua = core->lua;
@@ -354,6 +376,23 @@ static bool initLua(tic_mem* tic, const char* code)
       core->data->error(core->data->data, lua_tostring(lua, -1));
       return false;
     }
+
+    // SCN (or the old scanline) runs for every row, so it's looked up only once here
+    // and the blit skips the rows callback entirely if the cart has none
+    lua_getglobal(lua, SCN_FN);
+    if (!lua_isfunction(lua, -1))
+    {
+      lua_pop(lua, 1);
+      lua_getglobal(lua, "scanline");
+    }
+
+    if (lua_isfunction(lua, -1))
+      core->scanlineRef = luaL_ref(lua, LUA_REGISTRYINDEX);
+    else
+    {
+      lua_pop(lua, 1);
+      core->state.scanline = NULL;
+    }
   }
 
   return true;
@@ -419,33 +458,20 @@ static void callLuaTick(tic_mem* tic)
 }
 
 //#1470
-static void callLuaScanlineName(tic_mem* tic, s32 row, void* data, const char* name)
+static void callLuaScanline(tic_mem* tic, s32 row, void* data)
 {
   tic_core* core = (tic_core*)tic;
   lua_State* lua = core->lua;
 
   if (lua)
   {
-    lua_getglobal(lua, name);
-    if (lua_isfunction(lua, -1))
-    {
-      lua_pushinteger(lua, row);
-      if (docall(lua, 1, 0) == LUA_OK)
-        core->data->error(core->data->data, lua_tostring(lua, -1));
-    }
-    else lua_pop(lua, 1);
+    lua_rawgeti(lua, LUA_REGISTRYINDEX, core->scanlineRef);
+    lua_pushinteger(lua, row);
+    if (docall(lua, 1, 0) != LUA_OK)
+      core->data->error(core->data->data, lua_tostring(lua, -1));
   }
 }
 
-//#1488
-static void callLuaScanline(tic_mem* tic, s32 row, void* data)
-{
-  callLuaScanlineName(tic, row, data, SCN_FN);
-
-  // try to call old scanline
-  callLuaScanlineName(tic, row, data, "scanline");
-}
-
 //#1496
 static void callLuaOverline(tic_mem* tic, void* data)
 {
@@ -477,19 +503,13 @@ static const char* const LuaKeywords [] =
 
 static inline bool isalnum_(char c) {return isalnum(c) || c == '_';}
 
-static const tic_outline_item* getLuaOutline(const char* code, s32* size)
+static tic_outline_item* getLuaOutline(const char* code, s32* size)
 {
   enum{Size = sizeof(tic_outline_item)};
 
   *size = 0;
 
-  static tic_outline_item* items = NULL;
-
-  if (items)
-  {
-    free(items);
-    items = NULL;
-  }
+  tic_outline_item* items = NULL;
 
   const char* ptr = code;
 
@@ -553,6 +573,377 @@ static void evalLua(tic_mem* tic, const char* code)
   }
 }
 
+// save states keep the plain values of the globals the cart made, tables are
+// refilled in place on load, so the functions and metatables in them survive
+enum
+{
+  SnapEnd,
+  SnapFalse,
+  SnapTrue,
+  SnapInteger,
+  SnapNumber,
+  SnapString,
+  SnapTable,
+  SnapRef,
+};
+
+enum { SnapMaxDepth = 64 };
+
+typedef struct
+{
+  lua_State* lua;
+  u8* data;
+  s32 size;
+  s32 capacity;
+
+  // stack indices of the table -> id map and the builtin names
+  s32 ids;
+  s32 builtins;
+  s32 tables;
+} SnapWriter;
+
+typedef struct
+{
+  lua_State* lua;
+  const u8* data;
+  s32 size;
+  s32 pos;
+
+  // stack index of the id -> table map
+  s32 ids;
+  s32 tables;
+} SnapReader;
+
+// entries the snapshot doesn't keep: functions belong to the code, builtins
+// are there before the cart runs
+static bool isSnapSkipped(lua_State* lua, s32 key, s32 value, s32 builtins)
+{
+  if (lua_type(lua, key) == LUA_TFUNCTION || lua_type(lua, value) == LUA_TFUNCTION)
+    return true;
+
+  if (!builtins)
+    return false;
+
+  lua_pushvalue(lua, key);
+  bool builtin = lua_rawget(lua, builtins) != LUA_TNIL;
+  lua_pop(lua, 1);
+
+  return builtin;
+}
+
+static void writeSnap(SnapWriter* writer, const void* data, s32 size)
+{
+  if (writer->size + size > writer->capacity)
+    luaL_error(writer->lua, "the globals don't fit into the snapshot");
+
+  memcpy(writer->data + writer->size, data, size);
+  writer->size += size;
+}
+
+static void writeSnapTag(SnapWriter* writer, u8 tag)
+{
+  writeSnap(writer, &tag, sizeof tag);
+}
+
+static void writeSnapTable(SnapWriter* writer, s32 index, s32 builtins, s32 depth);
+
+static void writeSnapValue(SnapWriter* writer, s32 index, s32 depth)
+{
+  lua_State* lua = writer->lua;
+
+  switch (lua_type(lua, index))
+  {
+  case LUA_TBOOLEAN:
+    writeSnapTag(writer, lua_toboolean(lua, index) ? SnapTrue : SnapFalse);
+    break;
+  case LUA_TNUMBER:
+    if (lua_isinteger(lua, index))
+    {
+      lua_Integer value = lua_tointeger(lua, index);
+      writeSnapTag(writer, SnapInteger);
+      writeSnap(writer, &value, sizeof value);
+    }
+    else
+    {
+      lua_Number value = lua_tonumber(lua, index);
+      writeSnapTag(writer, SnapNumber);
+      writeSnap(writer, &value, sizeof value);
+    }
+    break;
+  case LUA_TSTRING:
+    {
+      size_t len = 0;
+      const char* text = lua_tolstring(lua, index, &len);
+      u32 size = (u32)len;
+
+      writeSnapTag(writer, SnapString);
+      writeSnap(writer, &size, sizeof size);
+      writeSnap(writer, text, size);
+    }
+    break;
+  case LUA_TTABLE:
+    {
+      // shared and cyclic tables are written once and referenced after that
+      lua_pushvalue(lua, index);
+      if (lua_rawget(lua, writer->ids) == LUA_TNUMBER)
+      {
+        u32 id = (u32)lua_tointeger(lua, -1);
+        writeSnapTag(writer, SnapRef);
+        writeSnap(writer, &id, sizeof id);
+        lua_pop(lua, 1);
+        break;
+      }
+      lua_pop(lua, 1);
+
+      if (depth >= SnapMaxDepth)
+        luaL_error(lua, "the globals are nested too deep for the snapshot");
+
+      lua_pushvalue(lua, index);
+      lua_pushinteger(lua, ++writer->tables);
+      lua_rawset(lua, writer->ids);
+
+      writeSnapTag(writer, SnapTable);
+      writeSnapTable(writer, index, 0, depth + 1);
+    }
+    break;
+  default:
+    luaL_error(lua, "a %s can't be saved in the snapshot", luaL_typename(lua, index));
+  }
+}
+
+static void writeSnapTable(SnapWriter* writer, s32 index, s32 builtins, s32 depth)
+{
+  lua_State* lua = writer->lua;
+
+  luaL_checkstack(lua, 8, NULL);
+  lua_pushnil(lua);
+
+  while (lua_next(lua, index))
+  {
+    s32 key = lua_absindex(lua, -2);
+    s32 value = lua_absindex(lua, -1);
+
+    if (!isSnapSkipped(lua, key, value, builtins))
+    {
+      writeSnapValue(writer, key, depth);
+      writeSnapValue(writer, value, depth);
+    }
+
+    lua_pop(lua, 1);
+  }
+
+  writeSnapTag(writer, SnapEnd);
+}
+
+static void readSnap(SnapReader* reader, void* data, s32 size)
+{
+  if (size > reader->size - reader->pos)
+    luaL_error(reader->lua, "the snapshot globals are corrupted");
+
+  memcpy(data, reader->data + reader->pos, size);
+  reader->pos += size;
+}
+
+static u8 readSnapTag(SnapReader* reader)
+{
+  u8 tag = 0;
+  readSnap(reader, &tag, sizeof tag);
+  return tag;
+}
+
+static void readSnapTable(SnapReader* reader, s32 index, s32 builtins, s32 depth);
+
+// pushes the value, a table is refilled in place if the one at `prev` is a table
+static void readSnapValue(SnapReader* reader, u8 tag, s32 prev, s32 depth)
+{
+  lua_State* lua = reader->lua;
+
+  switch (tag)
+  {
+  case SnapFalse:
+  case SnapTrue:
+    lua_pushboolean(lua, tag == SnapTrue);
+    break;
+  case SnapInteger:
+    {
+      lua_Integer value = 0;
+      readSnap(reader, &value, sizeof value);
+      lua_pushinteger(lua, value);
+    }
+    break;
+  case SnapNumber:
+    {
+      lua_Number value = 0;
+      readSnap(reader, &value, sizeof value);
+      lua_pushnumber(lua, value);
+    }
+    break;
+  case SnapString:
+    {
+      u32 size = 0;
+      readSnap(reader, &size, sizeof size);
+
+      if (size > reader->size - reader->pos)
+        luaL_error(lua, "the snapshot globals are corrupted");
+
+      lua_pushlstring(lua, (const char*)reader->data + reader->pos, size);
+      reader->pos += size;
+    }
+    break;
+  case SnapTable:
+    if (depth >= SnapMaxDepth)
+      luaL_error(lua, "the snapshot globals are corrupted");
+
+    if (prev && lua_type(lua, prev) == LUA_TTABLE)
+      lua_pushvalue(lua, prev);
+    else
+      lua_newtable(lua);
+
+    lua_pushvalue(lua, -1);
+    lua_rawseti(lua, reader->ids, ++reader->tables);
+
+    readSnapTable(reader, lua_absindex(lua, -1), 0, depth + 1);
+    break;
+  case SnapRef:
+    {
+      u32 id = 0;
+      readSnap(reader, &id, sizeof id);
+
+      if (id < 1 || id > reader->tables)
+        luaL_error(lua, "the snapshot globals are corrupted");
+
+      lua_rawgeti(lua, reader->ids, id);
+    }
+    break;
+  default:
+    luaL_error(lua, "the snapshot globals are corrupted");
+  }
+}
+
+static void readSnapTable(SnapReader* reader, s32 index, s32 builtins, s32 depth)
+{
+  lua_State* lua = reader->lua;
+
+  luaL_checkstack(lua, 8, NULL);
+
+  // the entries the snapshot replaces are moved aside, their tables get reused
+  lua_newtable(lua);
+  s32 prev = lua_gettop(lua);
+
+  lua_pushnil(lua);
+  while (lua_next(lua, index))
+  {
+    s32 key = lua_absindex(lua, -2);
+
+    if (!isSnapSkipped(lua, key, lua_absindex(lua, -1), builtins))
+    {
+      lua_pushvalue(lua, key);
+      lua_insert(lua, -2);
+      lua_rawset(lua, prev);
+
+      lua_pushvalue(lua, key);
+      lua_pushnil(lua);
+      lua_rawset(lua, index);
+    }
+    else lua_pop(lua, 1);
+  }
+
+  while (true)
+  {
+    u8 tag = readSnapTag(reader);
+
+    if (tag == SnapEnd)
+      break;
+
+    readSnapValue(reader, tag, 0, depth);
+
+    lua_pushvalue(lua, -1);
+    lua_rawget(lua, prev);
+    readSnapValue(reader, readSnapTag(reader), lua_absindex(lua, -1), depth);
+    lua_remove(lua, -2);
+    lua_rawset(lua, index);
+  }
+
+  lua_pop(lua, 1);
+}
+
+static s32 saveLuaGlobals(lua_State* lua)
+{
+  SnapWriter* writer = lua_touserdata(lua, 1);
+
+  lua_newtable(lua);
+  writer->ids = lua_gettop(lua);
+
+  lua_getfield(lua, LUA_REGISTRYINDEX, TicBuiltins);
+  writer->builtins = lua_gettop(lua);
+
+  lua_pushglobaltable(lua);
+  writeSnapTable(writer, lua_gettop(lua), writer->builtins, 0);
+
+  return 0;
+}
+
+static s32 loadLuaGlobals(lua_State* lua)
+{
+  SnapReader* reader = lua_touserdata(lua, 1);
+
+  lua_newtable(lua);
+  reader->ids = lua_gettop(lua);
+
+  lua_getfield(lua, LUA_REGISTRYINDEX, TicBuiltins);
+  s32 builtins = lua_gettop(lua);
+
+  lua_pushglobaltable(lua);
+  readSnapTable(reader, lua_gettop(lua), builtins, 0);
+
+  if (reader->pos != reader->size)
+    luaL_error(lua, "the snapshot globals are corrupted");
+
+  return 0;
+}
+
+static s32 saveLua(tic_mem* tic, void* buffer, s32 capacity)
+{
+  tic_core* core = (tic_core*)tic;
+  lua_State* lua = core->lua;
+
+  if (!lua) return 0;
+
+  SnapWriter writer = { .lua = lua, .data = buffer, .capacity = capacity };
+
+  lua_pushcfunction(lua, saveLuaGlobals);
+  lua_pushlightuserdata(lua, &writer);
+
+  if (lua_pcall(lua, 1, 0, 0) != LUA_OK)
+  {
+    lua_pop(lua, 1);
+    return -1;
+  }
+
+  return writer.size;
+}
+
+static bool loadLua(tic_mem* tic, const void* buffer, s32 size)
+{
+  tic_core* core = (tic_core*)tic;
+  lua_State* lua = core->lua;
+
+  if (!lua) return false;
+
+  SnapReader reader = { .lua = lua, .data = buffer, .size = size };
+
+  lua_pushcfunction(lua, loadLuaGlobals);
+  lua_pushlightuserdata(lua, &reader);
+
+  if (lua_pcall(lua, 1, 0, 0) != LUA_OK)
+  {
+    lua_pop(lua, 1);
+    return false;
+  }
+
+  return true;
+}
+
 //#1600
 static const tic_script_config LuaSyntaxConfig =
 {
@@ -565,6 +956,8 @@ static const tic_script_config LuaSyntaxConfig =
 
   .getOutline         = getLuaOutline,
   .eval               = evalLua,
+  .save               = saveLua,
+  .load               = loadLua,
 
   .blockCommentStart  = "--[[",
   .blockCommentEnd    = "]]",
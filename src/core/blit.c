@@ -0,0 +1,196 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "blit.h"
+#include "defines.h"
+
+void tic_core_blit_row_scalar(u32* dst, const u8* src, s32 count, const u32* pal)
+{
+	for (; count >= 2; count -= 2)
+	{
+		u8 val = *src++;
+		*dst++ = pal[val & 0xf];
+		*dst++ = pal[val >> 4];
+	}
+
+	if (count)
+		*dst = pal[*src & 0xf];
+}
+
+// The SIMD expanders gather from the 16 entry palette with byte shuffles: the palette is
+// split into four planes (one per color channel byte), every plane is looked up with the
+// nibble indices and the results are interleaved back into 32bit pixels.
+#if defined(TIC_BLIT_X86)
+#	include <immintrin.h>
+
+#	define BLIT_SSSE3 __attribute__((target("ssse3")))
+#	define BLIT_AVX2 __attribute__((target("avx2")))
+
+static BLIT_SSSE3 inline void palettePlanesSsse3(const u32* pal, __m128i planes[4])
+{
+	const __m128i Split = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+
+	__m128i v0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)pal + 0), Split);
+	__m128i v1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)pal + 1), Split);
+	__m128i v2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)pal + 2), Split);
+	__m128i v3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)pal + 3), Split);
+
+	__m128i t0 = _mm_unpacklo_epi32(v0, v1);
+	__m128i t1 = _mm_unpacklo_epi32(v2, v3);
+	__m128i t2 = _mm_unpackhi_epi32(v0, v1);
+	__m128i t3 = _mm_unpackhi_epi32(v2, v3);
+
+	planes[0] = _mm_unpacklo_epi64(t0, t1);
+	planes[1] = _mm_unpackhi_epi64(t0, t1);
+	planes[2] = _mm_unpacklo_epi64(t2, t3);
+	planes[3] = _mm_unpackhi_epi64(t2, t3);
+}
+
+BLIT_SSSE3 void tic_core_blit_row_ssse3(u32* dst, const u8* src, s32 count, const u32* pal)
+{
+	enum { Pixels = 16 };
+
+	__m128i planes[4];
+	palettePlanesSsse3(pal, planes);
+
+	const __m128i Mask = _mm_set1_epi8(0xf);
+
+	for (; count >= Pixels; count -= Pixels, src += Pixels / 2, dst += Pixels)
+	{
+		__m128i bytes = _mm_loadl_epi64((const __m128i*)src);
+		__m128i lo = _mm_and_si128(bytes, Mask);
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), Mask);
+		__m128i index = _mm_unpacklo_epi8(lo, hi);
+
+		__m128i c0 = _mm_shuffle_epi8(planes[0], index);
+		__m128i c1 = _mm_shuffle_epi8(planes[1], index);
+		__m128i c2 = _mm_shuffle_epi8(planes[2], index);
+		__m128i c3 = _mm_shuffle_epi8(planes[3], index);
+
+		__m128i c01lo = _mm_unpacklo_epi8(c0, c1);
+		__m128i c01hi = _mm_unpackhi_epi8(c0, c1);
+		__m128i c23lo = _mm_unpacklo_epi8(c2, c3);
+		__m128i c23hi = _mm_unpackhi_epi8(c2, c3);
+
+		_mm_storeu_si128((__m128i*)dst + 0, _mm_unpacklo_epi16(c01lo, c23lo));
+		_mm_storeu_si128((__m128i*)dst + 1, _mm_unpackhi_epi16(c01lo, c23lo));
+		_mm_storeu_si128((__m128i*)dst + 2, _mm_unpacklo_epi16(c01hi, c23hi));
+		_mm_storeu_si128((__m128i*)dst + 3, _mm_unpackhi_epi16(c01hi, c23hi));
+	}
+
+	tic_core_blit_row_scalar(dst, src, count, pal);
+}
+
+BLIT_AVX2 void tic_core_blit_row_avx2(u32* dst, const u8* src, s32 count, const u32* pal)
+{
+	enum { Pixels = 32 };
+
+	__m256i planes[4];
+	{
+		__m128i planes128[4];
+		palettePlanesSsse3(pal, planes128);
+
+		for (s32 i = 0; i < COUNT_OF(planes); i++)
+			planes[i] = _mm256_broadcastsi128_si256(planes128[i]);
+	}
+
+	const __m128i Mask = _mm_set1_epi8(0xf);
+
+	for (; count >= Pixels; count -= Pixels, src += Pixels / 2, dst += Pixels)
+	{
+		__m128i bytes = _mm_loadu_si128((const __m128i*)src);
+		__m128i lo = _mm_and_si128(bytes, Mask);
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), Mask);
+
+		// every 128bit lane shuffles on its own: pixels 0-15 go low, 16-31 go high
+		__m256i index = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi8(lo, hi)), _mm_unpackhi_epi8(lo, hi), 1);
+
+		__m256i c0 = _mm256_shuffle_epi8(planes[0], index);
+		__m256i c1 = _mm256_shuffle_epi8(planes[1], index);
+		__m256i c2 = _mm256_shuffle_epi8(planes[2], index);
+		__m256i c3 = _mm256_shuffle_epi8(planes[3], index);
+
+		__m256i c01lo = _mm256_unpacklo_epi8(c0, c1);
+		__m256i c01hi = _mm256_unpackhi_epi8(c0, c1);
+		__m256i c23lo = _mm256_unpacklo_epi8(c2, c3);
+		__m256i c23hi = _mm256_unpackhi_epi8(c2, c3);
+
+		__m256i p0 = _mm256_unpacklo_epi16(c01lo, c23lo);
+		__m256i p1 = _mm256_unpackhi_epi16(c01lo, c23lo);
+		__m256i p2 = _mm256_unpacklo_epi16(c01hi, c23hi);
+		__m256i p3 = _mm256_unpackhi_epi16(c01hi, c23hi);
+
+		_mm256_storeu_si256((__m256i*)dst + 0, _mm256_permute2x128_si256(p0, p1, 0x20));
+		_mm256_storeu_si256((__m256i*)dst + 1, _mm256_permute2x128_si256(p2, p3, 0x20));
+		_mm256_storeu_si256((__m256i*)dst + 2, _mm256_permute2x128_si256(p0, p1, 0x31));
+		_mm256_storeu_si256((__m256i*)dst + 3, _mm256_permute2x128_si256(p2, p3, 0x31));
+	}
+
+	tic_core_blit_row_ssse3(dst, src, count, pal);
+}
+
+#elif defined(TIC_BLIT_NEON)
+#	include <arm_neon.h>
+
+void tic_core_blit_row_neon(u32* dst, const u8* src, s32 count, const u32* pal)
+{
+	enum { Pixels = 16 };
+
+	const uint8x16x4_t planes = vld4q_u8((const u8*)pal);
+	const uint8x8_t Mask = vdup_n_u8(0xf);
+
+	for (; count >= Pixels; count -= Pixels, src += Pixels / 2, dst += Pixels)
+	{
+		uint8x8_t bytes = vld1_u8(src);
+		uint8x8x2_t nibbles = vzip_u8(vand_u8(bytes, Mask), vshr_n_u8(bytes, 4));
+		uint8x16_t index = vcombine_u8(nibbles.val[0], nibbles.val[1]);
+
+		uint8x16x4_t colors =
+		{{
+			vqtbl1q_u8(planes.val[0], index),
+			vqtbl1q_u8(planes.val[1], index),
+			vqtbl1q_u8(planes.val[2], index),
+			vqtbl1q_u8(planes.val[3], index),
+		}};
+
+		vst4q_u8((u8*)dst, colors);
+	}
+
+	tic_core_blit_row_scalar(dst, src, count, pal);
+}
+
+#endif
+
+tic_blit_row tic_core_blit_row_func()
+{
+#if defined(TIC_BLIT_X86)
+	if (__builtin_cpu_supports("avx2"))
+		return tic_core_blit_row_avx2;
+
+	if (__builtin_cpu_supports("ssse3"))
+		return tic_core_blit_row_ssse3;
+#elif defined(TIC_BLIT_NEON)
+	return tic_core_blit_row_neon;
+#endif
+
+	return tic_core_blit_row_scalar;
+}
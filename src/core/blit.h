@@ -0,0 +1,62 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "tic80_types.h"
+
+// Row expanders convert `count` 4bpp pixels from a byte aligned `src` into 32bit colors.
+// The SIMD ones are compiled with target attributes, tic_core_blit_row_func() picks the
+// best one the cpu runs and the others may only be called where the cpu supports them.
+typedef void(*tic_blit_row)(u32* dst, const u8* src, s32 count, const u32* pal);
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   define TIC_BLIT_X86 1
+#elif defined(__ARM_NEON) && defined(__aarch64__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#   define TIC_BLIT_NEON 1
+#endif
+
+void tic_core_blit_row_scalar(u32* dst, const u8* src, s32 count, const u32* pal);
+
+#if defined(TIC_BLIT_X86)
+void tic_core_blit_row_ssse3(u32* dst, const u8* src, s32 count, const u32* pal);
+void tic_core_blit_row_avx2(u32* dst, const u8* src, s32 count, const u32* pal);
+#elif defined(TIC_BLIT_NEON)
+void tic_core_blit_row_neon(u32* dst, const u8* src, s32 count, const u32* pal);
+#endif
+
+tic_blit_row tic_core_blit_row_func();
+
+// expand `count` pixels of the packed `row` starting from pixel `start` (which may be odd)
+static inline void tic_core_blit_span(tic_blit_row blitRow, u32* dst, const u8* row, s32 start, s32 count, const u32* pal)
+{
+  if (count <= 0) return;
+
+  if (start & 1)
+  {
+    *dst++ = pal[row[start >> 1] >> 4];
+    start++;
+    count--;
+  }
+
+  blitRow(dst, row + (start >> 1), count, pal);
+}
@@ -1,5 +1,6 @@
 #include "api.h"
 #include "core.h"
+#include "blit.h"
 #include "tilesheet.h"
 
 #include <assert.h>
@@ -16,9 +17,115 @@ static_assert(sizeof(tic_map) < 1024 * 32,        "tic_map");
 static_assert(sizeof(tic_vram) == TIC_VRAM_SIZE,  "tic_vram");
 static_assert(sizeof(tic_ram) == TIC_RAM_SIZE,    "tic_ram");
 
+extern void tic_core_dirty_rows(tic_core* core, s32 top, s32 bottom);
+
+static void dirtyTiles(tic_core* core, s32 address, s32 size, s32 start, s32 length, s32 tileSize, s32 slots, s32 first)
+{
+	if (address < start + length && address + size > start)
+	{
+		s32 from = (MAX(address, start) - start) / tileSize * slots + first;
+		s32 to = (MIN(address + size, start + length) - start - 1) / tileSize * slots + slots + first;
+
+		for (s32 i = from; i < to; i++)
+			core->tiles.valid[i >> 5] &= ~(1u << (i & 31));
+	}
+}
+
+void tic_core_dirty_ram(tic_mem* memory, s32 address, s32 size)
+{
+	enum { RowSize = TIC80_WIDTH * TIC_PALETTE_BPP / BITS_IN_BYTE };
+
+	tic_core* core = (tic_core*)memory;
+
+	if (size <= 0) return;
+
+	if (address < sizeof(tic_screen) && address + size > 0)
+		tic_core_dirty_rows(core, address / RowSize, (address + size - 1) / RowSize + 1);
+
+	dirtyTiles(core, address, size, offsetof(tic_ram, tiles), sizeof(tic_tiles) + sizeof(tic_sprites),
+		sizeof(tic_tile), TIC_TILE_CACHE_SLOTS, 0);
+	dirtyTiles(core, address, size, offsetof(tic_ram, font), sizeof(tic_font),
+		sizeof(tic_font) / TIC_FONT_CHARS, 1, TIC_TILE_CACHE_TILES);
+
+	if (address < offsetof(tic_ram, font) + sizeof(tic_font) && address + size > offsetof(tic_ram, font))
+		core->glyphs.valid = false;
+
+	if (address < offsetof(tic_ram, vram.palette) + sizeof(tic_palette) && address + size > offsetof(tic_ram, vram.palette))
+		core->palette.touched = true;
+
+	// the playing frame is decoded from the patterns and tracks
+	if (address < offsetof(tic_ram, music) + sizeof(tic_music) && address + size > offsetof(tic_ram, music))
+		core->state.music.decoded.track = -1;
+}
+
+//#60
+u8 tic_api_peek(tic_mem* memory, s32 address)
+{
+	if (address >= 0 && address < sizeof(tic_ram))
+		return *((u8*)&memory->ram + address);
+
+	return 0;
+}
+
+//#68
+void tic_api_poke(tic_mem* memory, s32 address, u8 value)
+{
+	if (address >= 0 && address < sizeof(tic_ram))
+	{
+		*((u8*)&memory->ram + address) = value;
+		tic_core_dirty_ram(memory, address, 1);
+	}
+}
+
+//#74
+u8 tic_api_peek4(tic_mem* memory, s32 address)
+{
+	if (address >= 0 && address < sizeof(tic_ram) * 2)
+		return tic_tool_peek4((u8*)&memory->ram, address);
+
+	return 0;
+}
+
+//#82
+void tic_api_poke4(tic_mem* memory, s32 address, u8 value)
+{
+	if (address >= 0 && address < sizeof(tic_ram) * 2)
+	{
+		tic_tool_poke4((u8*)&memory->ram, address, value);
+		tic_core_dirty_ram(memory, address >> 1, 1);
+	}
+}
+
+//#88
+void tic_api_memcpy(tic_mem* memory, s32 dst, s32 src, s32 size)
+{
+	s32 bound = sizeof(tic_ram) - size;
+
+	if (size >= 0 && size <= sizeof(tic_ram) && dst >= 0 && src >= 0 && dst <= bound && src <= bound)
+	{
+		u8* base = (u8*)&memory->ram;
+		memcpy(base + dst, base + src, size);
+		tic_core_dirty_ram(memory, dst, size);
+	}
+}
+
+//#100
+void tic_api_memset(tic_mem* memory, s32 dst, u8 val, s32 size)
+{
+	s32 bound = sizeof(tic_ram) - size;
+
+	if (size >= 0 && size <= sizeof(tic_ram) && dst >= 0 && dst <= bound)
+	{
+		u8* base = (u8*)&memory->ram;
+		memset(base + dst, val, size);
+		tic_core_dirty_ram(memory, dst, size);
+	}
+}
+
 static void setPixelDma(tic_mem* tic, s32 x, s32 y, u8 color)
 {
 	tic_tool_poke4(tic->ram.vram.screen.data, y * TIC80_WIDTH + x, color);
+	tic_core_dirty_rows((tic_core*)tic, y, y + 1);
 }
 
 static u8 getPixelDma(tic_mem* tic, s32 x, s32 y)
@@ -29,23 +136,141 @@ static u8 getPixelDma(tic_mem* tic, s32 x, s32 y)
 
 static void drawHLineDma(tic_mem* memory, s32 xl, s32 xr, s32 y, u8 color)
 {
-	color = color << 4 | color;
-
 	if (xl >= xr) return;
 
+	tic_core_dirty_rows((tic_core*)memory, y, y + 1);
+
+	u8* row = memory->ram.vram.screen.data + y * TIC80_WIDTH / 2;
+
 	if (xl & 1)
+		tic_tool_poke4(row, xl++, color);
+
+	if (xr & 1)
+		tic_tool_poke4(row, --xr, color);
+
+	// both ends are byte aligned now, memset fills the rest a word at a time
+	if (xl < xr)
+		memset(row + xl / 2, (color & 0xf) * 0x11, (xr - xl) / 2);
+}
+
+static inline void setOverlayRow(tic_core* core, s32 y)
+{
+	core->overlay.rows[y >> 5] |= 1u << (y & 31);
+}
+
+static void setPixelOvr(tic_mem* tic, s32 x, s32 y, u8 color)
+{
+	tic_core* core = (tic_core*)tic;
+	core->overlay.pixels[y * TIC80_WIDTH + x] = color & 0xf;
+	setOverlayRow(core, y);
+}
+
+static u8 getPixelOvr(tic_mem* tic, s32 x, s32 y)
+{
+	tic_core* core = (tic_core*)tic;
+	u8 color = core->overlay.pixels[y * TIC80_WIDTH + x];
+
+	// where OVR hasn't drawn yet the screen below shows through
+	return color == TIC_OVERLAY_EMPTY ? getPixelDma(tic, x, y) : color;
+}
+
+static void drawHLineOvr(tic_mem* tic, s32 xl, s32 xr, s32 y, u8 color)
+{
+	if (xl >= xr) return;
+
+	tic_core* core = (tic_core*)tic;
+	memset(core->overlay.pixels + y * TIC80_WIDTH + xl, color & 0xf, xr - xl);
+	setOverlayRow(core, y);
+}
+
+static void clearOverlay(tic_core* core)
+{
+	for (s32 r = 0; r < TIC80_HEIGHT; r++)
+		if (core->overlay.rows[r >> 5] & (1u << (r & 31)))
+			memset(core->overlay.pixels + r * TIC80_WIDTH, TIC_OVERLAY_EMPTY, TIC80_WIDTH);
+
+	memset(core->overlay.rows, 0, sizeof core->overlay.rows);
+}
+
+// true while the pixel functions write straight into vram.screen
+bool tic_core_is_dma(tic_mem* memory)
+{
+	return ((tic_core*)memory)->state.setpix == setPixelDma;
+}
+
+static u64 getNanos()
+{
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline u64 profileStart(tic_core* core)
+{
+	return core->profile.on ? getNanos() : 0;
+}
+
+static inline void profileEnd(tic_core* core, tic80_profile_phase phase, u64 start)
+{
+	if (core->profile.on)
+		core->profile.frame[phase] += getNanos() - start;
+}
+
+// the time of the frame is complete when the next one starts
+static void profileFrame(tic_core* core)
+{
+	for (s32 i = 0; i < TIC80_PROFILE_PHASES; i++)
+		core->profile.history[i][core->profile.pos] = (u32)MIN(core->profile.frame[i], UINT32_MAX);
+
+	memset(core->profile.frame, 0, sizeof core->profile.frame);
+
+	core->profile.pos = (core->profile.pos + 1) % TIC_PROFILE_FRAMES;
+	core->profile.count = MIN(core->profile.count + 1, TIC_PROFILE_FRAMES);
+}
+
+void tic_core_profile(tic_mem* memory, bool on)
+{
+	tic_core* core = (tic_core*)memory;
+
+	if (on && !core->profile.on)
 	{
-		tic_tool_poke4(&memory->ram.vram.screen.data, y * TIC80_WIDTH + xl, color);
-		xl++;
+		memset(core->profile.frame, 0, sizeof core->profile.frame);
+		core->profile.pos = core->profile.count = 0;
+	}
+
+	core->profile.on = on;
+}
+
+static s32 compareTime(const void* a, const void* b)
+{
+	u32 x = *(const u32*)a, y = *(const u32*)b;
+	return (x > y) - (x < y);
+}
+
+void tic_core_profile_stats(tic_mem* memory, tic80_profile_stats* stats)
+{
+	tic_core* core = (tic_core*)memory;
+	s32 count = core->profile.count;
+
+	memset(stats, 0, sizeof(tic80_profile_stats) * TIC80_PROFILE_PHASES);
+
+	if (!count) return;
+
+	for (s32 i = 0; i < TIC80_PROFILE_PHASES; i++)
+	{
+		u32 sorted[TIC_PROFILE_FRAMES];
+		memcpy(sorted, core->profile.history[i], sizeof(u32) * count);
+		qsort(sorted, count, sizeof(u32), compareTime);
+
+		u64 sum = 0;
+		for (s32 f = 0; f < count; f++)
+			sum += sorted[f];
+
+		stats[i].last = core->profile.history[i][(core->profile.pos + TIC_PROFILE_FRAMES - 1) % TIC_PROFILE_FRAMES] / 1e3f;
+		stats[i].min = sorted[0] / 1e3f;
+		stats[i].avg = sum / count / 1e3f;
+		stats[i].p99 = sorted[(count * 99 + 99) / 100 - 1] / 1e3f;
 	}
-	s32 count = (xr - xl) >> 1;
-	u8* screen = memory->ram.vram.screen.data + ((y * TIC80_WIDTH + xl) >> 1);
-	for (s32 i = 0; i < count; i++)
-		*screen++ = color;
-	if (xr & 1)
-  	{
-		tic_tool_poke4(&memory->ram.vram.screen.data, y * TIC80_WIDTH + xr - 1, color);
-  	}
 }
 
 static void resetPalette(tic_mem* memory)
@@ -89,7 +314,7 @@ static void soundClear(tic_mem* memory)
 	}
 
 	memset(&memory->ram.registers, 0, sizeof memory->ram.registers);
-	memset(&memory->samples.buffer, 0, memory->samples.size);
+	memset(memory->samples.buffer, 0, memory->samples.size);
 
 	tic_api_music(memory, -1, 0, 0, false, false, -1, -1);
 }
@@ -132,6 +357,11 @@ void tic_api_sync(tic_mem* tic, u32 mask, s32 bank, bool toCart)
 		if (mask & Sections[i].mask)
 			sync((u8*)&tic->ram + Sections[i].ram, (u8*)&tic->cart.banks[bank] + Sections[i].bank, Sections[i].size, toCart);
 
+	if (!toCart)
+		for (s32 i = 0; i < Count; i++)
+			if (mask & Sections[i].mask)
+				tic_core_dirty_ram(tic, Sections[i].ram, Sections[i].size);
+
 	// copy OVR palette
 	if (mask & tic_sync_palette)
 		sync(&core->state.ovr.palette, &tic->cart.banks[bank].palette.ovr, sizeof(tic_palette), toCart);
@@ -215,6 +445,7 @@ static void cart2ram(tic_mem* memory)
 	};
 
 	memcpy(memory->ram.font.data, Font, sizeof Font);
+	tic_core_dirty_ram(memory, offsetof(tic_ram, font), sizeof Font);
 
 	enum
 	{
@@ -260,6 +491,11 @@ void tic_core_tick(tic_mem* tic, tic_tick_data* data)
 
 			data->start = data->counter(core->data->data);
 
+			// set before init, so the script can drop the callbacks it doesn't define
+			core->state.tick = config->tick;
+			core->state.scanline = config->scanline;
+			core->state.ovr.callback = config->overline;
+
 			done = config->init(tic, code);
 		}
 		else
@@ -268,17 +504,13 @@ void tic_core_tick(tic_mem* tic, tic_tick_data* data)
 		}
 
 		if (done)
-		{
-			core->state.tick = config->tick;
-			core->state.scanline = config->scanline;
-			core->state.ovr.callback = config->overline;
-
 			core->state.initialized = true;
-		}
 		else return;
 	}
 
+	u64 start = profileStart(core);
 	core->state.tick(tic);
+	profileEnd(core, TIC80_PROFILE_TICK, start);
 }
 
 //#463
@@ -299,13 +531,90 @@ void tic_core_close(tic_mem* memory)
 	free(core);
 }
 
+bool tic_core_snapshot_save(tic_mem* memory, tic_core_snapshot* snapshot)
+{
+	tic_core* core = (tic_core*)memory;
+
+	memcpy(&snapshot->ram, &memory->ram, sizeof(tic_ram));
+	memcpy(&snapshot->state, &core->state, sizeof(tic_core_state_data));
+	snapshot->input = memory->input.data;
+	snapshot->vmSize = 0;
+
+	// a script that can't save its globals couldn't be restored either
+	if (core->state.initialized)
+	{
+		const tic_script_config* config = tic_core_script_config(memory);
+
+		if (!config->save)
+			return false;
+
+		snapshot->vmSize = config->save(memory, snapshot->vm, sizeof snapshot->vm);
+	}
+
+	return snapshot->vmSize >= 0;
+}
+
+bool tic_core_snapshot_load(tic_mem* memory, const tic_core_snapshot* snapshot)
+{
+	tic_core* core = (tic_core*)memory;
+
+	if (snapshot->vmSize < 0 || snapshot->vmSize > sizeof snapshot->vm)
+		return false;
+
+	// the globals go first, so if they fail RAM and the core state stay as they are
+	if (snapshot->vmSize)
+	{
+		const tic_script_config* config = tic_core_script_config(memory);
+
+		if (!core->state.initialized || !config->load
+			|| !config->load(memory, snapshot->vm, snapshot->vmSize))
+			return false;
+	}
+
+	// the running script functions and the pixel functions stay as they are
+	tic_core_state_data state = core->state;
+
+	memcpy(&memory->ram, &snapshot->ram, sizeof(tic_ram));
+	memcpy(&core->state, &snapshot->state, sizeof(tic_core_state_data));
+	memory->input.data = snapshot->input;
+
+	core->state.tick = state.tick;
+	core->state.scanline = state.scanline;
+	core->state.ovr.callback = state.ovr.callback;
+	core->state.setpix = state.setpix;
+	core->state.getpix = state.getpix;
+	core->state.drawhline = state.drawhline;
+	core->state.initialized = state.initialized;
+
+	// the saved pointers belong to the core the snapshot was taken from
+	for (s32 i = 0; i < TIC_SOUND_CHANNELS; i++)
+	{
+		core->state.sfx.channels[i].pos = &memory->ram.sfxpos[i];
+		core->state.music.channels[i].pos = &core->state.music.sfxpos[i];
+	}
+
+	tic_core_dirty_ram(memory, 0, sizeof(tic_ram));
+	tic_core_sound_restore(memory);
+
+	return true;
+}
+
 //#480
 void tic_core_tick_start(tic_mem* memory)
 {
+	tic_core* core = (tic_core*)memory;
+
+	if (core->profile.on)
+		profileFrame(core);
+
+	u64 start = profileStart(core);
 	tic_core_sound_tick_start(memory);
+	profileEnd(core, TIC80_PROFILE_SOUND, start);
+
+	start = profileStart(core);
 	tic_core_tick_io(memory);
+	profileEnd(core, TIC80_PROFILE_IO, start);
 
-	tic_core* core = (tic_core*)memory;
 	core->state.synced = 0;
 	resetDma(memory);
 }
@@ -319,12 +628,16 @@ void tic_core_tick_end(tic_mem* memory)
 	core->state.gamepads.previous.data = input->gamepads.data;
 	core->state.keyboard.previous.data = input->keyboard.data;
 
-	// TODO 
-	//tic_core_sound_tick_end(memory);
+	u64 start = profileStart(core);
+	tic_core_sound_tick_end(memory);
+	profileEnd(core, TIC80_PROFILE_SOUND, start);
 
-	//core->state.setpix = setPixelOvr;
-	//core->state.getpix = getPixelOvr;
-	//core->state.drawhline = drawHLineOvr;
+	// OVR is called by the blit, until the next tick everything is drawn to the overlay
+	clearOverlay(core);
+
+	core->state.setpix = setPixelOvr;
+	core->state.getpix = getPixelOvr;
+	core->state.drawhline = drawHLineOvr;
 }
 
 // copied from SDL2
@@ -346,58 +659,171 @@ static inline void memset4(void* dst, u32 val, u32 dwords)
 	}
 }
 
-//#535
-void tic_core_blit_ex(tic_mem* tic, tic80_pixel_color_format fmt, tic_scanline scanline, tic_overline overline, void* data)
+static const u32* getPalette(tic_core* core, const tic_palette* src, tic80_pixel_color_format fmt)
 {
-	// init OVR palette
+	if (core->palette.fmt != fmt || memcmp(&core->palette.src, src, sizeof(tic_palette)))
 	{
-		tic_core* core = (tic_core*)tic;
+		memcpy(&core->palette.src, src, sizeof(tic_palette));
+		core->palette.fmt = fmt;
+		tic_tool_palette_blit(core->palette.raw, src, fmt);
+	}
 
-		const tic_palette* pal = EMPTY(core->state.ovr.palette.data)
-			? &tic->ram.vram.palette
-			: &core->state.ovr.palette;
+	return core->palette.raw;
+}
+
+static bool isBlitValid(const tic_core* core, tic80_pixel_color_format fmt)
+{
+	const tic_vram* vram = &core->memory.ram.vram;
+
+	return core->blit.valid
+		&& core->blit.fmt == fmt
+		&& core->blit.border == vram->vars.border
+		&& core->blit.offset.x == vram->vars.offset.x
+		&& core->blit.offset.y == vram->vars.offset.y
+		&& memcmp(&core->blit.palette, &vram->palette, sizeof(tic_palette)) == 0;
+}
+
+static void saveBlit(tic_core* core, tic80_pixel_color_format fmt)
+{
+	const tic_vram* vram = &core->memory.ram.vram;
+
+	memcpy(&core->blit.palette, &vram->palette, sizeof(tic_palette));
+	core->blit.fmt = fmt;
+	core->blit.border = vram->vars.border;
+	core->blit.offset.x = vram->vars.offset.x;
+	core->blit.offset.y = vram->vars.offset.y;
+}
+
+static inline bool isRowSet(const u32* rows, s32 row)
+{
+	return rows[row >> 5] & (1u << (row & 31));
+}
+
+static void blitOverlay(tic_core* core, u32* out)
+{
+	const u32* pal = core->state.ovr.raw;
+
+	memcpy(core->overlay.drawn, core->overlay.rows, sizeof core->overlay.drawn);
 
-		memcpy(core->state.ovr.raw, tic_tool_palette_blit(pal, fmt), sizeof core->state.ovr.raw);		
+	for (s32 r = 0; r < TIC80_HEIGHT; r++)
+	{
+		if (!isRowSet(core->overlay.rows, r))
+			continue;
+
+		const u8* src = core->overlay.pixels + r * TIC80_WIDTH;
+		u32* dst = out + (r + TIC80_MARGIN_TOP) * TIC80_FULLWIDTH + TIC80_MARGIN_LEFT;
+
+		for (s32 x = 0; x < TIC80_WIDTH; x++)
+			if (src[x] != TIC_OVERLAY_EMPTY)
+				dst[x] = pal[src[x]];
 	}
+}
+
+// `tracked` callbacks write RAM only through the api, so a palette change
+// between the rows is seen by tic_core_dirty_ram() and nothing has to be compared
+static void blit(tic_mem* tic, tic80_pixel_color_format fmt, tic_scanline scanline, tic_overline overline, void* data, bool tracked)
+{
+	tic_core* core = (tic_core*)tic;
+
+	// the scanline callback can change anything between the rows, so the clean rows
+	// are reused only if the palette, border and offset are the same as last time
+	bool redraw = scanline || !isBlitValid(core, fmt);
+
+	if (!redraw && !overline && EMPTY(core->blit.dirty) && EMPTY(core->overlay.rows) && EMPTY(core->overlay.drawn))
+		return;
+
+	// the callbacks are profiled on their own
+	u64 start = profileStart(core);
+	u64 callbacks = core->profile.frame[TIC80_PROFILE_SCANLINE] + core->profile.frame[TIC80_PROFILE_OVERLINE];
+
+	saveBlit(core, fmt);
 
 	if (scanline)
+	{
+		u64 start = profileStart(core);
 		scanline(tic, 0, data);
+		profileEnd(core, TIC80_PROFILE_SCANLINE, start);
+	}
 
-	const u32* pal = tic_tool_palette_blit(&tic->ram.vram.palette, fmt);
+	const u32* pal = getPalette(core, &tic->ram.vram.palette, fmt);
+	const tic_blit_row blitRow = tic_core_blit_row_func();
+
+	core->palette.touched = false;
 
 	u32* out = tic->screen;
 
-	memset4(&out[0 * TIC80_FULLWIDTH], pal[tic->ram.vram.vars.border], TIC80_FULLWIDTH * TIC80_MARGIN_TOP);
+	if (redraw)
+		memset4(&out[0 * TIC80_FULLWIDTH], pal[tic->ram.vram.vars.border], TIC80_FULLWIDTH * TIC80_MARGIN_TOP);
 
 	u32* rowPtr = out + (TIC80_MARGIN_TOP * TIC80_FULLWIDTH);
 	for (s32 r = 0; r < TIC80_HEIGHT; r++, rowPtr += TIC80_FULLWIDTH)
 	{
-		u32* colPtr = rowPtr + TIC80_MARGIN_LEFT;
-		memset4(rowPtr, pal[tic->ram.vram.vars.border], TIC80_MARGIN_LEFT);
-
-		s32 pos = (r + tic->ram.vram.vars.offset.y + TIC80_HEIGHT) % TIC80_HEIGHT * TIC80_WIDTH >> 1;
+		s32 src = (r + tic->ram.vram.vars.offset.y + TIC80_HEIGHT) % TIC80_HEIGHT;
 
-		u32 x = (-tic->ram.vram.vars.offset.x + TIC80_WIDTH) % TIC80_WIDTH;
-		for (s32 c = 0; c < TIC80_WIDTH / 2; c++)
+		// the rows the overlay covered last frame are restored as well
+		if (redraw || isRowSet(core->blit.dirty, src) || isRowSet(core->overlay.drawn, r))
 		{
-			u8 val = ((u8*)tic->ram.vram.screen.data)[pos + c];
-			*(colPtr + (x++ % TIC80_WIDTH)) = pal[val & 0xf];
-			*(colPtr + (x++ % TIC80_WIDTH)) = pal[val >> 4];
-		}
+			u32* colPtr = rowPtr + TIC80_MARGIN_LEFT;
+			memset4(rowPtr, pal[tic->ram.vram.vars.border], TIC80_MARGIN_LEFT);
+
+			const u8* row = tic->ram.vram.screen.data + (src * TIC80_WIDTH >> 1);
 
-		memset4(rowPtr + (TIC80_FULLWIDTH - TIC80_MARGIN_RIGHT), pal[tic->ram.vram.vars.border], TIC80_MARGIN_RIGHT);
+			// horizontal offset wraps the row around, so it is drawn as two contiguous spans
+			s32 x = (-tic->ram.vram.vars.offset.x + TIC80_WIDTH) % TIC80_WIDTH;
+			tic_core_blit_span(blitRow, colPtr + x, row, 0, TIC80_WIDTH - x, pal);
+			tic_core_blit_span(blitRow, colPtr, row, TIC80_WIDTH - x, x, pal);
+
+			memset4(rowPtr + (TIC80_FULLWIDTH - TIC80_MARGIN_RIGHT), pal[tic->ram.vram.vars.border], TIC80_MARGIN_RIGHT);
+		}
 
 		if (scanline && (r < TIC80_HEIGHT - 1))
 		{
+			u64 start = profileStart(core);
 			scanline(tic, r + 1, data);
-			pal = tic_tool_palette_blit(&tic->ram.vram.palette, fmt);
+			profileEnd(core, TIC80_PROFILE_SCANLINE, start);
+
+			if (core->palette.touched || !tracked)
+			{
+				pal = getPalette(core, &tic->ram.vram.palette, fmt);
+				core->palette.touched = false;
+			}
 		}
 
+	}
+
+	if (redraw)
 		memset4(&out[(TIC80_FULLHEIGHT - TIC80_MARGIN_BOTTOM) * TIC80_FULLWIDTH], pal[tic->ram.vram.vars.border], TIC80_FULLWIDTH * TIC80_MARGIN_BOTTOM);
 
-		if (overline)
-			overline(tic, data);
+	memset(core->blit.dirty, 0, sizeof core->blit.dirty);
+	core->blit.valid = !scanline;
+
+	if (overline)
+	{
+		u64 start = profileStart(core);
+		overline(tic, data);
+		profileEnd(core, TIC80_PROFILE_OVERLINE, start);
 	}
+
+	if (!EMPTY(core->overlay.rows))
+	{
+		const tic_palette* ovrpal = EMPTY(core->state.ovr.palette.data)
+			? &tic->ram.vram.palette
+			: &core->state.ovr.palette;
+
+		tic_tool_palette_blit(core->state.ovr.raw, ovrpal, fmt);
+	}
+
+	blitOverlay(core, out);
+
+	if (core->profile.on)
+		core->profile.frame[TIC80_PROFILE_BLIT] += getNanos() - start
+			- (core->profile.frame[TIC80_PROFILE_SCANLINE] + core->profile.frame[TIC80_PROFILE_OVERLINE] - callbacks);
+}
+
+//#535
+void tic_core_blit_ex(tic_mem* tic, tic80_pixel_color_format fmt, tic_scanline scanline, tic_overline overline, void* data)
+{
+	blit(tic, fmt, scanline, overline, data, false);
 }
 
 //#589
@@ -420,11 +846,16 @@ static inline void overline(tic_mem* memory, void* data)
 //#605
 void tic_core_blit(tic_mem* tic, tic80_pixel_color_format fmt)
 {
-	tic_core_blit_ex(tic, fmt, scanline, overline, NULL);
+	tic_core* core = (tic_core*)tic;
+
+	// pass only the callbacks the script has, so the blit can skip the clean rows
+	blit(tic, fmt,
+		core->state.initialized && core->state.scanline ? scanline : NULL,
+		core->state.initialized && core->state.ovr.callback ? overline : NULL, NULL, true);
 }
 
 //#610
-tic_mem* tic_core_create(s32 samplerate)
+tic_mem* tic_core_create(s32 samplerate, tic80_sound_format format, s32 channels)
 {
 	tic_core* core = (tic_core*)malloc(sizeof(tic_core));
 	memset(core, 0, sizeof(tic_core));
@@ -436,8 +867,13 @@ tic_mem* tic_core_create(s32 samplerate)
 
 	core->memory.screen_format = TIC80_PIXEL_COLOR_RGBA8888;
 	core->samplerate = samplerate;
+	core->soundFormat = format;
+	core->channels = channels;
+
+	memset(core->overlay.pixels, TIC_OVERLAY_EMPTY, sizeof core->overlay.pixels);
 
-	core->memory.samples.size = samplerate * TIC_STEREO_CHANNELS / TIC80_FRAMERATE * sizeof(s16);
+	// room for a tick rounded up, blip_buf carries the fraction between ticks
+	core->memory.samples.size = TIC_TICK_SAMPLES(samplerate) * channels * TIC80_SOUND_BYTES(format);
 	core->memory.samples.buffer = malloc(core->memory.samples.size);
 
 	core->blip.left = blip_new(samplerate / 10);
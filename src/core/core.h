@@ -27,7 +27,17 @@
 #include "blip_buf.h"
 
 #define CLOCKRATE (255<<13)
+#define TIC_TICK_SAMPLES(samplerate) (((samplerate) + TIC80_FRAMERATE - 1) / TIC80_FRAMERATE)
 #define TIC_DEFAULT_COLOR 15
+#define TIC_DIRTY_ROWS_SIZE ((TIC80_HEIGHT + 31) / 32)
+#define TIC_OVERLAY_EMPTY 0xff
+#define TIC_KEYS_MASK_SIZE ((tic_keys_count + 31) / 32)
+#define TIC_PROFILE_FRAMES 128
+
+// a 32 byte tile unpacks to 1 (4bpp), 2 (2bpp) or 4 (1bpp) tiles
+#define TIC_TILE_CACHE_SLOTS (1 + 2 + 4)
+#define TIC_TILE_CACHE_TILES (TIC_BANK_SPRITES * 2 * TIC_TILE_CACHE_SLOTS)
+#define TIC_TILE_CACHE_SIZE (TIC_TILE_CACHE_TILES + TIC_FONT_CHARS)
 
 typedef struct {
   s32 time;
@@ -48,6 +58,16 @@ typedef struct {
   s32          duration;
 } tic_channel_data;
 
+// a pattern row unpacked when the music enters its frame
+typedef struct {
+  u8 note;
+  u8 octave;
+  u8 sfx;
+  u8 command;
+  u8 param1;
+  u8 param2;
+} tic_music_event;
+
 typedef struct {
   struct {
     s32 tick;
@@ -72,7 +92,8 @@ typedef struct {
   } finepitch;
 
   struct {
-    const tic_track_row* row;
+    bool active;
+    tic_music_event event;
     s32 ticks;
   } delay;
 } tic_command_data;
@@ -101,6 +122,12 @@ typedef struct
   struct {
     tic80_keyboard previous;
     u32 holds[tic_keys_count];
+
+    // bits of the keys down in `previous` and in the input of this tick
+    struct {
+      u32 previous[TIC_KEYS_MASK_SIZE];
+      u32 current[TIC_KEYS_MASK_SIZE];
+    } mask;
   } keyboard;
 
   tic_clip_data clip;
@@ -122,6 +149,16 @@ typedef struct
     tic_jump_command jump;
     s32 tempo;
     s32 speed;
+
+    // tick the next row starts at, the row is recomputed only then
+    s32 next;
+
+    // rows of the playing frame, decoded when the track or frame changes
+    struct {
+      s32 track;
+      s32 frame;
+      tic_music_event events[TIC_SOUND_CHANNELS][MUSIC_PATTERN_ROWS];
+    } decoded;
   } music;
 
   tic_tick tick;
@@ -151,15 +188,81 @@ typedef struct {
 #undef SCRIPT_DEF
   };
 
+  // registry reference to the SCN function, resolved once by the script init
+  s32 scanlineRef;
+
   struct {
     blip_buffer_t* left;
     blip_buffer_t* right;
   } blip;
 
   s32 samplerate;
+  tic80_sound_format soundFormat;
+  s32 channels;
   tic_tick_data* data;
   tic_core_state_data state;
 
+  // last converted palette, rebuilt only when the colors or the format change
+  struct {
+    tic_palette src;
+    tic80_pixel_color_format fmt;
+    u32 raw[TIC_PALETTE_SIZE];
+    bool touched;
+  } palette;
+
+  // output of the last blit, reused for the rows of vram.screen nobody wrote to
+  struct {
+    u32 dirty[TIC_DIRTY_ROWS_SIZE];
+    bool valid;
+
+    tic_palette palette;
+    tic80_pixel_color_format fmt;
+    u8 border;
+
+    struct {
+      s8 x;
+      s8 y;
+    } offset;
+  } blit;
+
+  // tiles and font chars unpacked to a byte per pixel on first use,
+  // an entry is dropped when its memory is written
+  struct {
+    u32 valid[(TIC_TILE_CACHE_SIZE + 31) / 32];
+    u8 pixels[TIC_TILE_CACHE_SIZE][TIC_SPRITESIZE * TIC_SPRITESIZE];
+  } tiles;
+
+  // left and right ends of every row of a filled ellipse being drawn
+  struct {
+    s32 l[TIC80_HEIGHT];
+    s32 r[TIC80_HEIGHT];
+  } sides;
+
+  // OVR layer, a color index per pixel or TIC_OVERLAY_EMPTY, cleared by tic_core_tick_end()
+  // and composited by the blit over the output `rows` it was drawn to, `drawn` are
+  // the rows composited by the last blit
+  struct {
+    u8 pixels[TIC80_WIDTH * TIC80_HEIGHT];
+    u32 rows[TIC_DIRTY_ROWS_SIZE];
+    u32 drawn[TIC_DIRTY_ROWS_SIZE];
+  } overlay;
+
+  // nanoseconds spent in every phase of the last TIC_PROFILE_FRAMES frames
+  struct {
+    bool on;
+    u64 frame[TIC80_PROFILE_PHASES];
+    u32 history[TIC80_PROFILE_PHASES][TIC_PROFILE_FRAMES];
+    s32 pos;
+    s32 count;
+  } profile;
+
+  // proportional widths of the font chars, see updateGlyphs()
+  struct {
+    u8 start[TIC_FONT_CHARS];
+    u8 end[TIC_FONT_CHARS];
+    bool valid;
+  } glyphs;
+
   struct {
     tic_core_state_data state;
     tic_ram ram;
@@ -171,6 +274,29 @@ typedef struct {
   } pause;
 } tic_core;
 
+#define TIC_SNAPSHOT_VM_SIZE (64 * 1024)
+
+// machine state, see tic_core_snapshot_save()
+typedef struct {
+  tic_ram ram;
+  tic_core_state_data state;
+  u8 input;
+
+  // globals of the running script, see tic_script_config.save
+  s32 vmSize;
+  u8 vm[TIC_SNAPSHOT_VM_SIZE];
+} tic_core_snapshot;
+
+inline void tic_core_dirty_rows(tic_core* core, s32 top, s32 bottom)
+{
+  for (s32 y = MAX(top, 0), end = MIN(bottom, TIC80_HEIGHT); y < end; y++)
+    core->blit.dirty[y >> 5] |= 1u << (y & 31);
+}
+
+bool tic_core_is_dma(tic_mem* memory);
+bool tic_core_snapshot_save(tic_mem* memory, tic_core_snapshot* snapshot);
+bool tic_core_snapshot_load(tic_mem* memory, const tic_core_snapshot* snapshot);
 void tic_core_tick_io(tic_mem* memory);
 void tic_core_sound_tick_start(tic_mem* memory);
 void tic_core_sound_tick_end(tic_mem* memory);
+void tic_core_sound_restore(tic_mem* memory);
@@ -26,6 +26,7 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 
 #define TRANSPARENT_COLOR 255
 
@@ -57,6 +58,64 @@ static tic_tilesheet getTileSheetFromSegment(tic_mem* memory, u8 segment)
     || ((x) >= core->state.clip.r) \
   )
 
+static void unpackTile(const tic_tileptr* tile, u8* pixels)
+{
+  enum { Size = TIC_SPRITESIZE };
+
+  if (tile->segment->peek == tic_tool_peek4 && tile->segment->tile_width == Size)
+  {
+    const u8* src = tile->ptr + (tile->offset >> 1);
+
+    for (s32 i = 0; i < Size * Size / 2; i++)
+    {
+      *pixels++ = src[i] & 0xf;
+      *pixels++ = src[i] >> 4;
+    }
+  }
+  else
+  {
+    for (s32 y = 0; y < Size; y++)
+      for (s32 x = 0; x < Size; x++)
+        *pixels++ = tic_tilesheet_gettilepix(tile, x, y);
+  }
+}
+
+// one byte per pixel tile from the cache, tiles outside of the tiles,
+// sprites and font memory are unpacked to the buffer every time
+static const u8* getTilePixels(tic_core* core, const tic_tileptr* tile, u8* buffer)
+{
+  enum { Size = TIC_SPRITESIZE, CharSize = sizeof(tic_font) / TIC_FONT_CHARS };
+
+  const u8* tiles = (const u8*)&core->memory.ram.tiles;
+  const u8* font = core->memory.ram.font.data;
+
+  s32 index;
+  if (tile->ptr >= tiles && tile->ptr < tiles + sizeof(tic_tiles) + sizeof(tic_sprites))
+  {
+    // 4bpp - slot 0, 2bpp - slots 1..2, 1bpp - slots 3..6
+    s32 slot = tile->segment->tile_width / Size - 1 + tile->offset / Size;
+    index = (s32)(tile->ptr - tiles) / sizeof(tic_tile) * TIC_TILE_CACHE_SLOTS + slot;
+  }
+  else if (tile->ptr >= font && tile->ptr < font + sizeof(tic_font) && tile->segment->tile_width == Size)
+    index = TIC_TILE_CACHE_TILES + (s32)(tile->ptr - font) / CharSize;
+  else
+  {
+    unpackTile(tile, buffer);
+    return buffer;
+  }
+
+  u8* pixels = core->tiles.pixels[index];
+  u32 bit = 1u << (index & 31);
+
+  if (!(core->tiles.valid[index >> 5] & bit))
+  {
+    unpackTile(tile, pixels);
+    core->tiles.valid[index >> 5] |= bit;
+  }
+
+  return pixels;
+}
+
 //#83
 static void drawHLine(tic_core* core, s32 x, s32 y, s32 width, u8 color)
 {
@@ -67,47 +126,99 @@ static void drawHLine(tic_core* core, s32 x, s32 y, s32 width, u8 color)
 
   core->state.drawhline(&core->memory, xl, xr, y, color);
 }
-//#104
+
+// clips once, then fills the rows of vram.screen directly or through drawhline
 static void drawRect(tic_core* core, s32 x, s32 y, s32 width, s32 height, u8 color)
 {
-  for (s32 i = y; i < y + height; ++i)
-    drawHLine(core, x, i, width, color);
+  s32 l = MAX(x, core->state.clip.l);
+  s32 t = MAX(y, core->state.clip.t);
+  s32 r = MIN(x + width, core->state.clip.r);
+  s32 b = MIN(y + height, core->state.clip.b);
+
+  if (l >= r || t >= b) return;
+
+  if (!tic_core_is_dma(&core->memory))
+  {
+    for (s32 i = t; i < b; i++)
+      core->state.drawhline(&core->memory, l, r, i, color);
+
+    return;
+  }
+
+  enum { Pitch = TIC80_WIDTH / 2 };
+
+  tic_core_dirty_rows(core, t, b);
+
+  color &= 0xf;
+
+  bool head = l & 1, tail = r & 1;
+  s32 start = (l + 1) / 2;
+  s32 size = r / 2 - start;
+  u8 fill = color * 0x11;
+
+  for (u8* row = core->memory.ram.vram.screen.data + t * Pitch, *end = row + (b - t) * Pitch; row < end; row += Pitch)
+  {
+    if (head) row[l / 2] = (row[l / 2] & 0x0f) | (color << 4);
+    if (size > 0) memset(row + start, fill, size);
+    if (tail) row[r / 2] = (row[r / 2] & 0xf0) | color;
+  }
 }
-//#271
-static s32 drawChar(tic_core* core, tic_tileptr* font_char, s32 x, s32 y, s32 scale, bool fixed, u8* mapping)
+
+// proportional start/end columns of every font char, rebuilt after ram.font is written
+static void updateGlyphs(tic_core* core)
 {
   enum { Size = TIC_SPRITESIZE };
 
-  s32 j = 0, start = 0, end = Size;
+  const u8* font = core->memory.ram.font.data;
 
-  if (!fixed) 
+  for (s32 i = 0; i < TIC_FONT_CHARS; i++)
   {
-    for (s32 i = 0; i < Size; i++)
-    {
-      for (j = 0; j < Size; j++)
-        if (mapping[tic_tilesheet_gettilepix(font_char, i, j)] != TRANSPARENT_COLOR) break;
-      if ( j < Size) break; else start++;
-    }
-    for (s32 i = Size - 1; i >= start; i--)
+    // a font char row is one byte, bit x is column x
+    u8 mask = 0;
+    for (s32 row = 0; row < Size; row++)
+      mask |= font[i * Size + row];
+
+    s32 start = 0, end = Size;
+
+    if (mask)
     {
-      for ( j = 0; j < Size; j++)
-        if (mapping[tic_tilesheet_gettilepix(font_char, i, j)] != TRANSPARENT_COLOR) break;
-      if (j < Size) break; else end--;
+      while (!(mask & (1 << start))) start++;
+      while (!(mask & (1 << (end - 1)))) end--;
     }
+    else start = end;
+
+    core->glyphs.start[i] = start;
+    core->glyphs.end[i] = end;
   }
+
+  core->glyphs.valid = true;
+}
+
+//#271
+static s32 drawChar(tic_core* core, s32 index, s32 x, s32 y, s32 scale, bool fixed, u8 color)
+{
+  enum { Size = TIC_SPRITESIZE };
+
+  s32 start = fixed ? 0 : core->glyphs.start[index];
+  s32 end = fixed ? Size : core->glyphs.end[index];
   s32 width = end - start;
 
   if (EARLY_CLIP(x, y, Size * scale, Size * scale)) return width;
 
-  s32 colStart = start, colStep = 1, rowStart = 0, rowStep = 1;
+  const u8* rows = core->memory.ram.font.data + index * Size;
 
-  for (s32 i = 0, col = colStart, xs = x; i < width; i++, col += colStep, xs += scale)
+  for (s32 row = 0, ys = y; row < Size; row++, ys += scale)
   {
-    for (s32 j = 0, row = rowStart, ys = y; j < Size; j++, row += rowStep, ys += scale)
+    // every run of lit columns is one span
+    for (u32 bits = rows[row] >> start, col = 0; bits; )
     {
-      u8 color = tic_tilesheet_gettilepix(font_char, col, row);
-      if (mapping[color] != TRANSPARENT_COLOR)
-        drawRect(core, xs, ys, scale, scale, mapping[color]);
+      for (; !(bits & 1); bits >>= 1) col++;
+
+      s32 run = col;
+      for (; bits & 1; bits >>= 1) col++;
+
+      for (s32 i = 0; i < scale; i++)
+        drawHLine(core, x + run * scale, ys + i, (col - run) * scale, color);
     }
   }
 
@@ -115,12 +226,15 @@ static s32 drawChar(tic_core* core, tic_tileptr* font_char, s32 x, s32 y, s32 sc
 }
 
 //#307
-static s32 drawText(tic_core* core, tic_tilesheet* font_face, const char* text, s32 x, s32 y, s32 width, s32 height, bool fixed, u8* mapping, s32 scale, bool alt)
+static s32 drawText(tic_core* core, const char* text, s32 x, s32 y, s32 width, s32 height, bool fixed, u8 color, s32 scale, bool alt)
 {
   s32 pos = x;
   s32 MAX = x;
   char sym = 0;
 
+  if (!core->glyphs.valid)
+    updateGlyphs(core);
+
   while ((sym = *text++))
   {
     if (sym == '\n')
@@ -133,8 +247,8 @@ static s32 drawText(tic_core* core, tic_tilesheet* font_face, const char* text,
     }
     else 
     {
-      tic_tileptr font_char =tic_tilesheet_gettile(font_face, alt * TIC_FONT_CHARS / 2 + sym, true);
-      s32 size = drawChar(core, &font_char, pos, y, scale, fixed, mapping);
+      s32 index = (alt * TIC_FONT_CHARS / 2 + sym) & (TIC_FONT_CHARS - 1);
+      s32 size = drawChar(core, index, pos, y, scale, fixed, color);
       pos += ((!fixed && size) ? size + 1 : width) * scale;
     }
   }
@@ -142,6 +256,725 @@ static s32 drawText(tic_core* core, tic_tilesheet* font_face, const char* text,
   return pos > MAX ? pos - x : MAX - x;
 }
 
+// orientation bits, combined they cover the 8 flip and rotate variants
+enum
+{
+  MirrorX = 1,
+  MirrorY = 2,
+  SwapXY = 4,
+};
+
+static u32 getOrientation(tic_flip flip, tic_rotate rotate)
+{
+  u32 orientation = flip & (MirrorX | MirrorY);
+
+  switch (rotate & 3)
+  {
+  case tic_90_rotate:   orientation ^= MirrorX; break;
+  case tic_180_rotate:  orientation ^= MirrorX | MirrorY; break;
+  case tic_270_rotate:  orientation ^= MirrorY; break;
+  }
+
+  if (rotate == tic_90_rotate || rotate == tic_270_rotate)
+    orientation |= SwapXY;
+
+  return orientation;
+}
+
+// oriented and remapped 8x8 block, returns true if no pixel is transparent
+static bool getTileBlock(tic_core* core, const tic_tileptr* tile, const u8* mapping, u32 orientation, u8* block)
+{
+  enum { Size = TIC_SPRITESIZE, Last = Size - 1 };
+
+  u8 buffer[Size * Size];
+  const u8* pixels = getTilePixels(core, tile, buffer);
+
+  u8 mask = 0;
+
+#define TILE_BLOCK_BODY(INDEX)                      \
+  for (s32 py = 0; py < Size; py++)                 \
+    for (s32 px = 0; px < Size; px++)               \
+    {                                               \
+      u8 color = mapping[pixels[INDEX]];            \
+      mask |= color;                                \
+      *block++ = color;                             \
+    }
+
+  switch (orientation)
+  {
+  case 0:                               TILE_BLOCK_BODY(py * Size + px); break;
+  case MirrorX:                         TILE_BLOCK_BODY(py * Size + Last - px); break;
+  case MirrorY:                         TILE_BLOCK_BODY((Last - py) * Size + px); break;
+  case MirrorX | MirrorY:               TILE_BLOCK_BODY((Last - py) * Size + Last - px); break;
+  case SwapXY:                          TILE_BLOCK_BODY(px * Size + py); break;
+  case SwapXY | MirrorX:                TILE_BLOCK_BODY((Last - px) * Size + py); break;
+  case SwapXY | MirrorY:                TILE_BLOCK_BODY(px * Size + Last - py); break;
+  case SwapXY | MirrorX | MirrorY:      TILE_BLOCK_BODY((Last - px) * Size + Last - py); break;
+  }
+
+#undef TILE_BLOCK_BODY
+
+  // colors are 4 bit, only TRANSPARENT_COLOR sets the high bits
+  return !(mask & ~0xf);
+}
+
+static void drawSpanOpaque(u8* screen, s32 x, const u8* src, s32 count)
+{
+  u8* dst = screen + (x >> 1);
+
+  if (x & 1)
+  {
+    *dst = (*dst & 0x0f) | (*src++ << 4);
+    dst++;
+    count--;
+  }
+
+  for (; count > 1; count -= 2, src += 2)
+    *dst++ = src[0] | (src[1] << 4);
+
+  if (count)
+    *dst = (*dst & 0xf0) | *src;
+}
+
+static void drawSpanKeyed(u8* screen, s32 x, const u8* src, s32 count)
+{
+  for (const u8* end = src + count; src < end; src++, x++)
+    if (*src != TRANSPARENT_COLOR)
+      tic_tool_poke4(screen, x, *src);
+}
+
+//#194
+static void drawTile(tic_core* core, const tic_tileptr* tile, s32 x, s32 y, const u8* mapping, s32 scale, u32 orientation)
+{
+  enum { Size = TIC_SPRITESIZE };
+
+  s32 width = Size * scale;
+
+  if (EARLY_CLIP(x, y, width, width)) return;
+
+  u8 block[Size * Size];
+  bool opaque = getTileBlock(core, tile, mapping, orientation, block);
+
+  s32 l = MAX(x, core->state.clip.l);
+  s32 t = MAX(y, core->state.clip.t);
+  s32 r = MIN(x + width, core->state.clip.r);
+  s32 b = MIN(y + width, core->state.clip.b);
+
+  if (l >= r || t >= b) return;
+
+  if (!tic_core_is_dma(&core->memory))
+  {
+    for (s32 py = t; py < b; py++)
+    {
+      const u8* row = block + (py - y) / scale * Size;
+
+      for (s32 px = l; px < r; px++)
+      {
+        u8 color = row[(px - x) / scale];
+        if (color != TRANSPARENT_COLOR)
+          core->state.setpix(&core->memory, px, py, color);
+      }
+    }
+
+    return;
+  }
+
+  u8* screen = core->memory.ram.vram.screen.data;
+  tic_core_dirty_rows(core, t, b);
+
+  if (scale == 1)
+  {
+    const u8* row = block + (t - y) * Size + (l - x);
+    s32 count = r - l;
+
+    if (opaque)
+    {
+      if (count == Size && !(x & 1))
+      {
+        // whole tile inside the clip on a byte boundary
+        for (u8* dst = screen + ((t * TIC80_WIDTH + x) >> 1), *end = dst + (b - t) * TIC80_WIDTH / 2; dst < end; dst += TIC80_WIDTH / 2, row += Size)
+        {
+          dst[0] = row[0] | (row[1] << 4);
+          dst[1] = row[2] | (row[3] << 4);
+          dst[2] = row[4] | (row[5] << 4);
+          dst[3] = row[6] | (row[7] << 4);
+        }
+      }
+      else
+        for (s32 py = t; py < b; py++, row += Size)
+          drawSpanOpaque(screen, py * TIC80_WIDTH + l, row, count);
+    }
+    else
+      for (s32 py = t; py < b; py++, row += Size)
+        drawSpanKeyed(screen, py * TIC80_WIDTH + l, row, count);
+
+    return;
+  }
+
+  // scaled: stretch each source row once and repeat it
+  u8 line[TIC80_WIDTH];
+  s32 count = r - l;
+
+  for (s32 sy = (t - y) / scale, py = t; py < b; sy++)
+  {
+    const u8* row = block + sy * Size;
+
+    for (s32 i = 0, sx = l - x; i < count; i++, sx++)
+      line[i] = row[sx / scale];
+
+    for (s32 end = MIN(y + (sy + 1) * scale, b); py < end; py++)
+    {
+      if (opaque)
+        drawSpanOpaque(screen, py * TIC80_WIDTH + l, line, count);
+      else
+        drawSpanKeyed(screen, py * TIC80_WIDTH + l, line, count);
+    }
+  }
+}
+
+// colorkeys map to TRANSPARENT_COLOR, returns true if any color is keyed
+static bool getMapping(u8* mapping, const u8* colors, s32 count)
+{
+  for (s32 i = 0; i < TIC_PALETTE_SIZE; i++) mapping[i] = i;
+  for (s32 i = 0; i < count; i++) mapping[colors[i] % TIC_PALETTE_SIZE] = TRANSPARENT_COLOR;
+
+  return count > 0;
+}
+
+//#247
+static void drawSprite(tic_core* core, s32 index, s32 x, s32 y, s32 w, s32 h, u8* colors, s32 count, s32 scale, tic_flip flip, tic_rotate rotate)
+{
+  tic_tilesheet sheet = getTileSheetFromSegment(&core->memory, core->memory.ram.vram.blit.segment);
+
+  u8 mapping[TIC_PALETTE_SIZE];
+  getMapping(mapping, colors, count);
+
+  u32 orientation = getOrientation(flip, rotate);
+
+  if (w == 1 && h == 1)
+  {
+    tic_tileptr tile = tic_tilesheet_gettile(&sheet, index, false);
+    drawTile(core, &tile, x, y, mapping, scale, orientation);
+  }
+  else
+  {
+    s32 step = TIC_SPRITESIZE * scale;
+    s32 cols = sheet.segment->sheet_width;
+
+    const tic_flip vert_horz_flip = tic_horz_flip | tic_vert_flip;
+
+    bool swap = rotate == tic_90_rotate || rotate == tic_270_rotate;
+
+    if (EARLY_CLIP(x, y, (swap ? h : w) * step, (swap ? w : h) * step)) return;
+
+    for (s32 i = 0; i < w; i++)
+    {
+      for (s32 j = 0; j < h; j++)
+      {
+        s32 mx = i;
+        s32 my = j;
+
+        if (flip == tic_horz_flip || flip == vert_horz_flip) mx = w - 1 - i;
+        if (flip == tic_vert_flip || flip == vert_horz_flip) my = h - 1 - j;
+
+        if (rotate == tic_180_rotate)
+        {
+          mx = w - 1 - mx;
+          my = h - 1 - my;
+        }
+        else if (rotate == tic_90_rotate)
+        {
+          if (flip == tic_no_flip || flip == vert_horz_flip) my = h - 1 - my;
+          else mx = w - 1 - mx;
+        }
+        else if (rotate == tic_270_rotate)
+        {
+          if (flip == tic_no_flip || flip == vert_horz_flip) mx = w - 1 - mx;
+          else my = h - 1 - my;
+        }
+
+        tic_tileptr tile = tic_tilesheet_gettile(&sheet, index + mx + my * cols, false);
+
+        if (swap)
+          drawTile(core, &tile, x + j * step, y + i * step, mapping, scale, orientation);
+        else
+          drawTile(core, &tile, x + i * step, y + j * step, mapping, scale, orientation);
+      }
+    }
+  }
+}
+
+static inline s32 floorDiv(s32 a, s32 b)
+{
+  return a >= 0 ? a / b : -((b - 1 - a) / b);
+}
+
+static inline s32 wrapCell(s32 value, s32 size)
+{
+  value %= size;
+  return value < 0 ? value + size : value;
+}
+
+// one stretched and remapped screen line for every source row of a map row
+static void drawMapRow(tic_core* core, const u8** cells, s32 count, s32 x, s32 y, const u8* mapping, bool keyed, s32 scale)
+{
+  enum { Size = TIC_SPRITESIZE };
+
+  const s32 size = Size * scale;
+
+  s32 l = MAX(x, core->state.clip.l);
+  s32 t = MAX(y, core->state.clip.t);
+  s32 r = MIN(x + count * size, core->state.clip.r);
+  s32 b = MIN(y + size, core->state.clip.b);
+
+  u8* screen = core->memory.ram.vram.screen.data;
+  tic_core_dirty_rows(core, t, b);
+
+  u8 line[TIC80_WIDTH];
+
+  for (s32 sy = (t - y) / scale, py = t; py < b; sy++)
+  {
+    // first visible cell may start left of the clip
+    s32 offset = l - x;
+    s32 cell = offset / size;
+    s32 sx = offset % size / scale;
+    s32 step = offset % scale;
+
+    const u8* row = cells[cell] + sy * Size;
+
+    for (u8 *dst = line, *end = line + (r - l); dst < end; dst++)
+    {
+      *dst = mapping[row[sx]];
+
+      if (++step == scale)
+      {
+        step = 0;
+
+        if (++sx == Size)
+        {
+          sx = 0;
+
+          if (++cell < count)
+            row = cells[cell] + sy * Size;
+        }
+      }
+    }
+
+    for (s32 end = MIN(y + (sy + 1) * scale, b); py < end; py++)
+    {
+      if (keyed)
+        drawSpanKeyed(screen, py * TIC80_WIDTH + l, line, r - l);
+      else
+        drawSpanOpaque(screen, py * TIC80_WIDTH + l, line, r - l);
+    }
+  }
+}
+
+//#219
+static void drawMap(tic_core* core, const tic_map* src, s32 x, s32 y, s32 width, s32 height, s32 sx, s32 sy, u8* colors, s32 count, s32 scale, RemapFunc remap, RemapBatchFunc batch, void* data)
+{
+  enum
+  {
+    Size = TIC_SPRITESIZE,
+    MaxCols = TIC80_WIDTH / TIC_SPRITESIZE + 1,
+    MaxRows = TIC80_HEIGHT / TIC_SPRITESIZE + 1,
+  };
+
+  const s32 size = Size * scale;
+
+  // cull the cells outside of the clip rect up front
+  s32 left = MAX(0, floorDiv(core->state.clip.l - sx, size));
+  s32 top = MAX(0, floorDiv(core->state.clip.t - sy, size));
+  s32 right = MIN(width, floorDiv(core->state.clip.r - sx + size - 1, size));
+  s32 bottom = MIN(height, floorDiv(core->state.clip.b - sy + size - 1, size));
+
+  if (left >= right || top >= bottom
+    || core->state.clip.l >= core->state.clip.r || core->state.clip.t >= core->state.clip.b) return;
+
+  s32 cols = right - left;
+  s32 rows = bottom - top;
+
+  RemapResult retiles[MaxRows][MaxCols];
+
+  for (s32 j = 0; j < rows; j++)
+  {
+    s32 mj = wrapCell(y + top + j, TIC_MAP_HEIGHT);
+
+    for (s32 i = 0; i < cols; i++)
+    {
+      s32 mi = wrapCell(x + left + i, TIC_MAP_WIDTH);
+
+      RemapResult* retile = &retiles[j][i];
+      *retile = (RemapResult){ src->data[mi + mj * TIC_MAP_WIDTH], tic_no_flip, tic_no_rotate };
+
+      if (remap && !batch)
+        remap(data, mi, mj, retile);
+    }
+  }
+
+  // one call for all the visible cells instead of one per cell
+  if (batch)
+    batch(data, wrapCell(x + left, TIC_MAP_WIDTH), wrapCell(y + top, TIC_MAP_HEIGHT), cols, rows, &retiles[0][0], MaxCols);
+
+  tic_tilesheet sheet = getTileSheetFromSegment(&core->memory, core->memory.ram.vram.blit.segment);
+
+  u8 mapping[TIC_PALETTE_SIZE];
+  bool keyed = getMapping(mapping, colors, count);
+
+  if (!tic_core_is_dma(&core->memory))
+  {
+    for (s32 j = 0; j < rows; j++)
+      for (s32 i = 0; i < cols; i++)
+      {
+        const RemapResult* retile = &retiles[j][i];
+        tic_tileptr tile = tic_tilesheet_gettile(&sheet, retile->index, true);
+        drawTile(core, &tile, sx + (left + i) * size, sy + (top + j) * size, mapping, scale, getOrientation(retile->flip, retile->rotate));
+      }
+
+    return;
+  }
+
+  // the visible part of a map row goes out as one span per screen line
+  u8 identity[TIC_PALETTE_SIZE];
+  getMapping(identity, NULL, 0);
+
+  u8 buffers[MaxCols][Size * Size];
+  const u8* cells[MaxCols];
+
+  for (s32 j = 0; j < rows; j++)
+  {
+    for (s32 i = 0; i < cols; i++)
+    {
+      const RemapResult* retile = &retiles[j][i];
+      tic_tileptr tile = tic_tilesheet_gettile(&sheet, retile->index, true);
+      u32 orientation = getOrientation(retile->flip, retile->rotate);
+
+      if (orientation)
+      {
+        getTileBlock(core, &tile, identity, orientation, buffers[i]);
+        cells[i] = buffers[i];
+      }
+      else cells[i] = getTilePixels(core, &tile, buffers[i]);
+    }
+
+    drawMapRow(core, cells, cols, sx + left * size, sy + (top + j) * size, mapping, keyed, scale);
+  }
+}
+
+//#122
+static void setPixel(tic_core* core, s32 x, s32 y, u8 color)
+{
+  if (x < core->state.clip.l || y < core->state.clip.t || x >= core->state.clip.r || y >= core->state.clip.b) return;
+
+  core->state.setpix(&core->memory, x, y, color);
+}
+
+//#153
+static void drawLine(tic_core* core, s32 x0, s32 y0, s32 x1, s32 y1, u8 color)
+{
+  s32 dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+  s32 dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+
+  for (s32 err = dx + dy;;)
+  {
+    setPixel(core, x0, y0, color);
+
+    if (x0 == x1 && y0 == y1) break;
+
+    s32 e2 = err * 2;
+    if (e2 >= dy) { err += dy; x0 += sx; }
+    if (e2 <= dx) { err += dx; y0 += sy; }
+  }
+}
+
+static void setElliPixel(tic_mem* memory, s32 x, s32 y, u8 color)
+{
+  setPixel((tic_core*)memory, x, y, color);
+}
+
+static void setElliSide(tic_mem* memory, s32 x, s32 y, u8 color)
+{
+  tic_core* core = (tic_core*)memory;
+
+  if (y >= core->state.clip.t && y < core->state.clip.b)
+  {
+    if (x < core->sides.l[y]) core->sides.l[y] = x;
+    if (x > core->sides.r[y]) core->sides.r[y] = x;
+  }
+}
+
+// midpoint ellipse stepping inside the x0,y0 - x1,y1 box, one point per quadrant at a time
+static void drawEllipse(tic_mem* memory, s32 x0, s32 y0, s32 x1, s32 y1, u8 color, PixelFunc pix)
+{
+  s64 a = abs(x1 - x0), b = abs(y1 - y0), b1 = b & 1;
+  s64 dx = 4 * (1 - a) * b * b, dy = 4 * (b1 + 1) * a * a;
+  s64 err = dx + dy + b1 * a * a, e2;
+
+  if (x0 > x1) { x0 = x1; x1 += a; }
+  if (y0 > y1) y0 = y1;
+  y0 += (b + 1) / 2;
+  y1 = y0 - b1;
+  a *= 8 * a;
+  b1 = 8 * b * b;
+
+  do
+  {
+    pix(memory, x1, y0, color);
+    pix(memory, x0, y0, color);
+    pix(memory, x0, y1, color);
+    pix(memory, x1, y1, color);
+
+    e2 = 2 * err;
+    if (e2 <= dy) { y0++; y1--; err += dy += a; }
+    if (e2 >= dx || 2 * err > dy) { x0++; x1--; err += dx += b1; }
+  } while (x0 <= x1);
+
+  // flat ellipses stop early, finish the tips
+  while (y0 - y1 < b)
+  {
+    pix(memory, x0 - 1, y0, color);
+    pix(memory, x1 + 1, y0++, color);
+    pix(memory, x0 - 1, y1, color);
+    pix(memory, x1 + 1, y1--, color);
+  }
+}
+
+static void drawEllipseBorder(tic_core* core, s32 x, s32 y, s32 a, s32 b, u8 color)
+{
+  if (a < 0 || b < 0 || EARLY_CLIP(x - a, y - b, a * 2 + 1, b * 2 + 1)) return;
+
+  drawEllipse(&core->memory, x - a, y - b, x + a, y + b, color, setElliPixel);
+}
+
+// collects the row ends first, then every row is one span
+static void drawEllipseFill(tic_core* core, s32 x, s32 y, s32 a, s32 b, u8 color)
+{
+  if (a < 0 || b < 0 || EARLY_CLIP(x - a, y - b, a * 2 + 1, b * 2 + 1)) return;
+
+  s32 top = MAX(y - b, core->state.clip.t);
+  s32 bottom = MIN(y + b + 1, core->state.clip.b);
+
+  for (s32 i = top; i < bottom; i++)
+  {
+    core->sides.l[i] = INT32_MAX;
+    core->sides.r[i] = INT32_MIN;
+  }
+
+  drawEllipse(&core->memory, x - a, y - b, x + a, y + b, color, setElliSide);
+
+  for (s32 i = top; i < bottom; i++)
+  {
+    s32 xl = MAX(core->sides.l[i], core->state.clip.l);
+    s32 xr = MIN(core->sides.r[i] + 1, core->state.clip.r);
+
+    if (xl < xr)
+      core->state.drawhline(&core->memory, xl, xr, i, color);
+  }
+}
+
+// 16.16 fixed point, pixel centers are at +0.5
+#define FIXED_ONE (1 << 16)
+#define FIXED_HALF (FIXED_ONE / 2)
+#define FIXED_CEIL(V) (((V) + FIXED_ONE - 1) >> 16)
+
+// keeps the edge interpolation in initEdge() within s64
+static inline s32 toFixed(float value)
+{
+  enum { Limit = 8192 };
+  return (s32)(MIN(MAX(value, -Limit), Limit) * FIXED_ONE);
+}
+
+typedef void(*SpanFunc)(tic_core* core, s32 xl, s32 xr, s32 y, void* data);
+
+typedef struct
+{
+  s32 x;
+  s32 dx;
+} Edge;
+
+// edge x at the center of row y, stepped by dx per row
+static Edge initEdge(s32 xa, s32 ya, s32 xb, s32 yb, s32 y)
+{
+  s64 dy = (s64)yb - ya;
+
+  if (!dy)
+    return (Edge){ xa, 0 };
+
+  s64 width = (s64)xb - xa;
+  s64 x = xa + width * ((s64)y * FIXED_ONE + FIXED_HALF - ya) / dy;
+
+  // an edge less than a row tall is never stepped
+  s64 dx = width * FIXED_ONE / dy;
+  dx = MIN(MAX(dx, -INT32_MAX), INT32_MAX);
+
+  return (Edge){ (s32)x, (s32)dx };
+}
+
+// scanline triangle fill with the top-left rule: a pixel is drawn if its
+// center is inside, or on a top or left edge, spans are clipped before the call
+static void rasterTri(tic_core* core, const s32* xs, const s32* ys, SpanFunc span, void* data)
+{
+  s32 a = 0, b = 1, c = 2;
+
+  if (ys[a] > ys[b]) SWAP(a, b, s32);
+  if (ys[b] > ys[c]) SWAP(b, c, s32);
+  if (ys[a] > ys[b]) SWAP(a, b, s32);
+
+  s32 top = MAX(FIXED_CEIL(ys[a] - FIXED_HALF), core->state.clip.t);
+  s32 mid = FIXED_CEIL(ys[b] - FIXED_HALF);
+  s32 bottom = MIN(FIXED_CEIL(ys[c] - FIXED_HALF), core->state.clip.b);
+
+  if (top >= bottom) return;
+
+  Edge major = initEdge(xs[a], ys[a], xs[c], ys[c], top);
+  Edge minor = top < mid
+    ? initEdge(xs[a], ys[a], xs[b], ys[b], top)
+    : initEdge(xs[b], ys[b], xs[c], ys[c], top);
+
+  for (s32 y = top; y < bottom; y++)
+  {
+    if (y == mid)
+      minor = initEdge(xs[b], ys[b], xs[c], ys[c], y);
+
+    s32 xl = MIN(major.x, minor.x);
+    s32 xr = MAX(major.x, minor.x);
+
+    xl = MAX(FIXED_CEIL(xl - FIXED_HALF), core->state.clip.l);
+    xr = MIN(FIXED_CEIL(xr - FIXED_HALF), core->state.clip.r);
+
+    if (xl < xr)
+      span(core, xl, xr, y, data);
+
+    major.x += major.dx;
+    minor.x += minor.dx;
+  }
+}
+
+static void fillSpan(tic_core* core, s32 xl, s32 xr, s32 y, void* data)
+{
+  core->state.drawhline(&core->memory, xl, xr, y, *(const u8*)data);
+}
+
+typedef struct
+{
+  tic_tilesheet sheet;
+  const tic_map* map;
+  const u8* mapping;
+  bool keyed;
+
+  // affine uv at the origin and its screen gradients
+  float x, y, u, v;
+  float dudx, dudy, dvdx, dvdy;
+  s32 width, height;
+
+  s32 index;
+  const u8* pixels;
+  u8 buffer[TIC_SPRITESIZE * TIC_SPRITESIZE];
+} TexTri;
+
+static inline u8 sampleTexTri(tic_core* core, TexTri* tex, s32 u, s32 v)
+{
+  enum
+  {
+    Size = TIC_SPRITESIZE,
+    MapWidth = TIC_MAP_WIDTH * TIC_SPRITESIZE,
+    MapHeight = TIC_MAP_HEIGHT * TIC_SPRITESIZE,
+    SheetHeight = TIC_SPRITESHEET_SIZE * TIC_SPRITE_BANKS,
+  };
+
+  s32 index;
+
+  if (tex->map)
+  {
+    u = wrapCell(u, MapWidth);
+    v = wrapCell(v, MapHeight);
+    index = tex->map->data[(v / Size) * TIC_MAP_WIDTH + u / Size];
+  }
+  else
+  {
+    u &= tex->sheet.segment->sheet_width * Size - 1;
+    v &= SheetHeight - 1;
+    index = (v / Size) * tex->sheet.segment->sheet_width + u / Size;
+  }
+
+  // neighbouring pixels mostly come from the same tile
+  if (index != tex->index)
+  {
+    tic_tileptr tile = tic_tilesheet_gettile(&tex->sheet, index, tex->map != NULL);
+    tex->pixels = getTilePixels(core, &tile, tex->buffer);
+    tex->index = index;
+  }
+
+  return tex->mapping[tex->pixels[(v & (Size - 1)) * Size + (u & (Size - 1))]];
+}
+
+// the texture repeats, so wrapping in float first keeps any uv convertible
+static inline s64 uvToFixed(float value, s32 size)
+{
+  float wrapped = fmodf(value, (float)size);
+  return isnan(wrapped) ? 0 : (s64)(wrapped * FIXED_ONE);
+}
+
+static void texSpan(tic_core* core, s32 xl, s32 xr, s32 y, void* data)
+{
+  TexTri* tex = data;
+
+  float px = xl + 0.5f - tex->x;
+  float py = y + 0.5f - tex->y;
+
+  s64 u = uvToFixed(tex->u + px * tex->dudx + py * tex->dudy, tex->width);
+  s64 v = uvToFixed(tex->v + px * tex->dvdx + py * tex->dvdy, tex->height);
+  s64 du = uvToFixed(tex->dudx, tex->width);
+  s64 dv = uvToFixed(tex->dvdx, tex->height);
+
+  if (tic_core_is_dma(&core->memory))
+  {
+    u8 line[TIC80_WIDTH];
+
+    for (s32 i = 0; i < xr - xl; i++, u += du, v += dv)
+      line[i] = sampleTexTri(core, tex, u >> 16, v >> 16);
+
+    u8* screen = core->memory.ram.vram.screen.data;
+    tic_core_dirty_rows(core, y, y + 1);
+
+    if (tex->keyed)
+      drawSpanKeyed(screen, y * TIC80_WIDTH + xl, line, xr - xl);
+    else
+      drawSpanOpaque(screen, y * TIC80_WIDTH + xl, line, xr - xl);
+  }
+  else
+  {
+    for (s32 x = xl; x < xr; x++, u += du, v += dv)
+    {
+      u8 color = sampleTexTri(core, tex, u >> 16, v >> 16);
+      if (color != TRANSPARENT_COLOR)
+        core->state.setpix(&core->memory, x, y, color);
+    }
+  }
+}
+
+//#110
+void tic_api_cls(tic_mem* memory, u8 color)
+{
+  static const tic_clip_data EmptyClip = { 0, 0, TIC80_WIDTH, TIC80_HEIGHT };
+
+  tic_core* core = (tic_core*)memory;
+
+  if (tic_core_is_dma(memory) && memcmp(&core->state.clip, &EmptyClip, sizeof(tic_clip_data)) == 0)
+  {
+    memset(memory->ram.vram.screen.data, (color & 0xf) * 0x11, sizeof memory->ram.vram.screen.data);
+    tic_core_dirty_rows(core, 0, TIC80_HEIGHT);
+  }
+  else
+    drawRect(core, core->state.clip.l, core->state.clip.t, core->state.clip.r - core->state.clip.l, core->state.clip.b - core->state.clip.t, color);
+}
+
+//#161
+void tic_api_rect(tic_mem* memory, s32 x, s32 y, s32 width, s32 height, u8 color)
+{
+  drawRect((tic_core*)memory, x, y, width, height, color);
+}
+
 //#333
 void tic_api_clip(tic_mem* memory, s32 x, s32 y, s32 width, s32 height)
 {
@@ -158,14 +991,103 @@ void tic_api_clip(tic_mem* memory, s32 x, s32 y, s32 width, s32 height)
   if (core->state.clip.b > TIC80_HEIGHT) core->state.clip.b = TIC80_HEIGHT;
 }
 
+//#363
+void tic_api_spr(tic_mem* memory, s32 index, s32 x, s32 y, s32 w, s32 h, u8* colors, s32 count, s32 scale, tic_flip flip, tic_rotate rotate)
+{
+  if (scale > 0)
+    drawSprite((tic_core*)memory, index, x, y, w, h, colors, count, scale, flip, rotate);
+}
+
+//#370
+void tic_api_map(tic_mem* memory, s32 x, s32 y, s32 width, s32 height, s32 sx, s32 sy, u8* colors, s32 count, s32 scale, RemapFunc remap, RemapBatchFunc batch, void* data)
+{
+  if (scale > 0)
+    drawMap((tic_core*)memory, &memory->ram.map, x, y, width, height, sx, sy, colors, count, scale, remap, batch, data);
+}
+
+//#398
+void tic_api_tri(tic_mem* memory, s32 x1, s32 y1, s32 x2, s32 y2, s32 x3, s32 y3, u8 color)
+{
+  const s32 xs[] = { toFixed(x1), toFixed(x2), toFixed(x3) };
+  const s32 ys[] = { toFixed(y1), toFixed(y2), toFixed(y3) };
+
+  rasterTri((tic_core*)memory, xs, ys, fillSpan, &color);
+}
+
+//#409
+void tic_api_trib(tic_mem* memory, s32 x1, s32 y1, s32 x2, s32 y2, s32 x3, s32 y3, u8 color)
+{
+  tic_core* core = (tic_core*)memory;
+
+  drawLine(core, x1, y1, x2, y2, color);
+  drawLine(core, x2, y2, x3, y3, color);
+  drawLine(core, x3, y3, x1, y1, color);
+}
+
+//#419
+void tic_api_textri(tic_mem* memory, float x1, float y1, float x2, float y2, float x3, float y3,
+  float u1, float v1, float u2, float v2, float u3, float v3, bool use_map, u8* colors, s32 count)
+{
+  tic_core* core = (tic_core*)memory;
+
+  // screen space uv gradients, zero area triangles draw nothing
+  float det = (x2 - x1) * (y3 - y1) - (x3 - x1) * (y2 - y1);
+  if (det == 0) return;
+
+  u8 mapping[TIC_PALETTE_SIZE];
+  tic_tilesheet sheet = getTileSheetFromSegment(memory, memory->ram.vram.blit.segment);
+
+  TexTri tex =
+  {
+    .sheet = sheet,
+    .map = use_map ? &memory->ram.map : NULL,
+    .mapping = mapping,
+    .keyed = getMapping(mapping, colors, count),
+    .x = x1, .y = y1, .u = u1, .v = v1,
+    .dudx = ((u2 - u1) * (y3 - y1) - (u3 - u1) * (y2 - y1)) / det,
+    .dudy = ((u3 - u1) * (x2 - x1) - (u2 - u1) * (x3 - x1)) / det,
+    .dvdx = ((v2 - v1) * (y3 - y1) - (v3 - v1) * (y2 - y1)) / det,
+    .dvdy = ((v3 - v1) * (x2 - x1) - (v2 - v1) * (x3 - x1)) / det,
+    .width = (use_map ? TIC_MAP_WIDTH : sheet.segment->sheet_width) * TIC_SPRITESIZE,
+    .height = use_map ? TIC_MAP_HEIGHT * TIC_SPRITESIZE : TIC_SPRITESHEET_SIZE * TIC_SPRITE_BANKS,
+    .index = -1,
+  };
+
+  const s32 xs[] = { toFixed(x1), toFixed(x2), toFixed(x3) };
+  const s32 ys[] = { toFixed(y1), toFixed(y2), toFixed(y3) };
+
+  rasterTri(core, xs, ys, texSpan, &tex);
+}
+
+//#427
+void tic_api_circ(tic_mem* memory, s32 x, s32 y, s32 radius, u8 color)
+{
+  drawEllipseFill((tic_core*)memory, x, y, radius, radius, color);
+}
+
+//#434
+void tic_api_circb(tic_mem* memory, s32 x, s32 y, s32 radius, u8 color)
+{
+  drawEllipseBorder((tic_core*)memory, x, y, radius, radius, color);
+}
+
+//#440
+void tic_api_elli(tic_mem* memory, s32 x, s32 y, s32 a, s32 b, u8 color)
+{
+  drawEllipseFill((tic_core*)memory, x, y, a, b, color);
+}
+
+//#447
+void tic_api_ellib(tic_mem* memory, s32 x, s32 y, s32 a, s32 b, u8 color)
+{
+  drawEllipseBorder((tic_core*)memory, x, y, a, b, color);
+}
+
 //#385
 s32 tic_api_print(tic_mem* memory, const char* text, s32 x, s32 y, u8 color, bool fixed, s32 scale, bool alt)
 {
-  u8 mapping[] = { 255, color };
-  tic_tilesheet font_face = getTileSheetFromSegment(memory, 1);
-
   u8 width = alt ? TIC_ALTFONT_WIDTH : TIC_FONT_WIDTH;
   if (!fixed) width -= 2;
-  return drawText((tic_core*)memory, &font_face, text, x, y, width, TIC_FONT_HEIGHT, fixed, mapping, scale, alt);
+  return drawText((tic_core*)memory, text, x, y, width, TIC_FONT_HEIGHT, fixed, color, scale, alt);
 }
 
@@ -24,16 +24,26 @@
 #include "core.h"
 
 #include <assert.h>
+#include <string.h>
 
 static_assert(sizeof(tic80_input) == 12, "tic80_input");
 
-static bool isKeyPressed(const tic80_keyboard* input, tic_key key)
+static void getKeyMask(const tic80_keyboard* input, u32* mask)
 {
+    memset(mask, 0, sizeof(u32) * TIC_KEYS_MASK_SIZE);
+
     for (s32 i = 0; i < TIC80_KEY_BUFFER; i++)
-        if (input->keys[i] == key)
-            return true;
-    
-    return false;
+    {
+        tic_key key = input->keys[i];
+
+        if (key > tic_key_unknown && key < tic_keys_count)
+            mask[key >> 5] |= 1u << (key & 31);
+    }
+}
+
+static inline bool isKeySet(const u32* mask, tic_key key)
+{
+    return key < tic_keys_count && (mask[key >> 5] & (1u << (key & 31)));
 }
 
 void tic_core_tick_io(tic_mem* memory)
@@ -53,14 +63,68 @@ void tic_core_tick_io(tic_mem* memory)
     }
 
     // process keyboard
-    for (s32 i = 0; i < tic_keys_count; i++)
     {
-        bool prevDown = isKeyPressed(&core->state.keyboard.previous, i);
-        bool down = isKeyPressed(&memory->ram.input.keyboard, i);
+        u32* prev = core->state.keyboard.mask.previous;
+        u32* down = core->state.keyboard.mask.current;
 
-        u32* hold = &core->state.keyboard.holds[i];
+        getKeyMask(&core->state.keyboard.previous, prev);
+        getKeyMask(&memory->ram.input.keyboard, down);
 
-        if (prevDown && down) (*hold)++;
-        else *hold = 0;
+        // only a key that was down can have a hold counter, the others stay zero
+        u32 pending[TIC_KEYS_MASK_SIZE];
+        memcpy(pending, prev, sizeof pending);
+
+        for (s32 i = 0; i < TIC80_KEY_BUFFER; i++)
+        {
+            tic_key key = core->state.keyboard.previous.keys[i];
+
+            // the same key can be in the buffer twice
+            if (!isKeySet(pending, key))
+                continue;
+
+            pending[key >> 5] &= ~(1u << (key & 31));
+
+            u32* hold = &core->state.keyboard.holds[key];
+
+            if (isKeySet(down, key)) (*hold)++;
+            else *hold = 0;
+        }
+    }
+}
+
+bool tic_api_key(tic_mem* memory, tic_key key)
+{
+    tic_core* core = (tic_core*)memory;
+
+    return key > tic_key_unknown
+        ? isKeySet(core->state.keyboard.mask.current, key)
+        : !EMPTY(core->state.keyboard.mask.current);
+}
+
+bool tic_api_keyp(tic_mem* memory, tic_key key, s32 hold, s32 period)
+{
+    tic_core* core = (tic_core*)memory;
+    const u32* prev = core->state.keyboard.mask.previous;
+    const u32* down = core->state.keyboard.mask.current;
+
+    if (key > tic_key_unknown)
+    {
+        if (key >= tic_keys_count)
+            return false;
+
+        u32 held = core->state.keyboard.holds[key];
+
+        bool prevDown = hold >= 0 && period >= 0 && held >= hold
+            ? period && held % period
+            : isKeySet(prev, key);
+
+        return !prevDown && isKeySet(down, key);
     }
+
+    // any key pressed this tick
+    for (s32 i = 0; i < TIC_KEYS_MASK_SIZE; i++)
+        if (down[i] & ~prev[i])
+            return true;
+
+    return false;
 }
@@ -38,23 +38,40 @@ static s32 row2tick(tic_core* core, const tic_track* track, s32 row)
         ? row * getSpeed(core, track) * NOTES_PER_MINUTE / tempo / DEFAULT_SPEED
         : 0;
 }
+static s32 tick2row(tic_core* core, const tic_track* track, s32 tick)
+{
+    // BPM = tempo * 6 / speed
+    s32 speed = getSpeed(core, track);
+    return speed
+        ? tick * getTempo(core, track) * DEFAULT_SPEED / speed / NOTES_PER_MINUTE
+        : 0;
+}
+
+// first tick tick2row() maps to `row` or a later row
+static s32 rowStart(tic_core* core, const tic_track* track, s32 row)
+{
+    s32 num = getSpeed(core, track) * NOTES_PER_MINUTE;
+    s32 den = getTempo(core, track) * DEFAULT_SPEED;
+
+    return num > 0 && den > 0
+        ? (row * num + den - 1) / den
+        : -1;
+}
+
 //#134
 static s32 calcLoopPos(const tic_sound_loop* loop, s32 pos)
 {
-    s32 offset = 0;
-
     if (loop->size > 0)
     {
-        for (s32 i = 0; i < pos; i++)
-        {
-            if (offset < (loop->start + loop->size - 1))
-                offset++;
-            else offset = loop->start;
-        }
+        // runs up to the loop end once, then cycles through the loop
+        s32 end = loop->start + loop->size - 1;
+
+        return pos <= end
+            ? MAX(pos, 0)
+            : loop->start + (pos - end - 1) % loop->size;
     }
-    else offset = pos >= SFX_TICKS ? SFX_TICKS - 1 : pos;
 
-    return offset;
+    return pos >= SFX_TICKS ? SFX_TICKS - 1 : pos;
 }
 
 //#152
@@ -125,12 +142,6 @@ static void setChannelData(tic_mem* memory, s32 index, s32 note, s32 octave, s32
     }
 }
 
-//#240 TODO
-static void processMusic(tic_mem* memory)
-{
-
-}
-
 //#452
 static void setMusicChannelData(tic_mem* memory, s32 index, s32 note, s32 octave, s32 left, s32 right, s32 channel)
 {
@@ -175,7 +186,11 @@ static void setMusic(tic_core* core, s32 index, s32 frame, s32 row, bool loop, b
         core->state.music.tempo = tempo;
         core->state.music.speed = speed;
         core->state.music.ticks = row >= 0 ? row2tick(core, track, row) : 0;
+        core->state.music.next = 0;
     }
+
+    // the patterns could be edited since the last time
+    core->state.music.decoded.track = -1;
 }
 
 void tic_api_music(tic_mem* memory, s32 index, s32 frame, s32 row, bool loop, bool sustain, s32 tempo, s32 speed)
@@ -188,6 +203,277 @@ void tic_api_music(tic_mem* memory, s32 index, s32 frame, s32 row, bool loop, bo
         memory->ram.music_state.flag.music_status = tic_music_play;    
 }
 
+static void stopMusic(tic_mem* memory)
+{
+    tic_api_music(memory, -1, 0, 0, false, false, -1, -1);
+}
+
+static s32 param2val(const tic_music_event* event)
+{
+    return (event->param1 << 4) | event->param2;
+}
+
+// unpack the pattern rows of the frame once, so the ticks only index them
+static void decodeFrame(tic_mem* memory, s32 index, s32 frame)
+{
+    tic_core* core = (tic_core*)memory;
+    const tic_track* track = &memory->ram.music.tracks.data[index];
+
+    core->state.music.decoded.track = index;
+    core->state.music.decoded.frame = frame;
+
+    for (s32 c = 0; c < TIC_SOUND_CHANNELS; c++)
+    {
+        tic_music_event* event = core->state.music.decoded.events[c];
+        s32 patternId = tic_tool_get_pattern_id(track, frame, c);
+
+        if (patternId == 0 || patternId > MUSIC_PATTERNS)
+        {
+            memset(event, 0, sizeof(tic_music_event) * MUSIC_PATTERN_ROWS);
+            continue;
+        }
+
+        const tic_track_row* row = memory->ram.music.patterns.data[patternId - PATTERN_START].rows;
+
+        for (s32 r = 0; r < MUSIC_PATTERN_ROWS; r++, row++, event++)
+        {
+            event->note = row->note;
+            event->octave = row->octave;
+            event->sfx = (row->sfxhi << MUSIC_SFXID_LOW_BITS) | row->sfxlow;
+            event->command = row->command;
+            event->param1 = row->param1;
+            event->param2 = row->param2;
+        }
+    }
+}
+
+static void playEvent(tic_mem* memory, s32 c, const tic_music_event* event)
+{
+    tic_core* core = (tic_core*)memory;
+    tic_channel_data* channel = &core->state.music.channels[c];
+    tic_command_data* cmdData = &core->state.music.commands[c];
+
+    // reset commands data
+    if (event->note)
+    {
+        cmdData->slide.tick = 0;
+        cmdData->slide.note = channel->note;
+    }
+
+    if (event->note == NoteStop)
+        setMusicChannelData(memory, -1, 0, 0, channel->volume.left, channel->volume.right, c);
+    else if (event->note >= NoteStart)
+        setMusicChannelData(memory, event->sfx, event->note - NoteStart, event->octave, channel->volume.left, channel->volume.right, c);
+
+    switch (event->command)
+    {
+    case tic_music_cmdvolume:
+        channel->volume.left = event->param1;
+        channel->volume.right = event->param2;
+        break;
+
+    case tic_music_cmdchord:
+        cmdData->chord.tick = 0;
+        cmdData->chord.note1 = event->param1;
+        cmdData->chord.note2 = event->param2;
+        break;
+
+    case tic_music_cmdjump:
+        core->state.music.jump.active = true;
+        core->state.music.jump.frame = event->param1;
+        core->state.music.jump.beat = event->param2;
+        break;
+
+    case tic_music_cmdvibrato:
+        cmdData->vibrato.tick = 0;
+        cmdData->vibrato.period = event->param1;
+        cmdData->vibrato.depth = event->param2;
+        break;
+
+    case tic_music_cmdslide:
+        cmdData->slide.duration = param2val(event);
+        break;
+
+    case tic_music_cmdpitch:
+        cmdData->finepitch.value = param2val(event) - PITCH_DELTA;
+        break;
+
+    default: break;
+    }
+}
+
+//#240
+static void processMusic(tic_mem* memory)
+{
+    tic_core* core = (tic_core*)memory;
+    tic_music_state* music_state = &memory->ram.music_state;
+
+    if (music_state->flag.music_status == tic_music_stop || music_state->music.track < 0) return;
+
+    const tic_track* track = &memory->ram.music.tracks.data[music_state->music.track];
+    s32 ticks = core->state.music.ticks;
+    s32 row = music_state->music.row;
+
+    // the row only changes on the precomputed tick, no division in between
+    if (ticks >= core->state.music.next)
+    {
+        row = tick2row(core, track, ticks);
+
+        s32 next = rowStart(core, track, row + 1);
+        core->state.music.next = next > ticks ? next : ticks + 1;
+    }
+
+    tic_jump_command* jumpCmd = &core->state.music.jump;
+
+    if (row != music_state->music.row && jumpCmd->active)
+    {
+        music_state->music.frame = jumpCmd->frame;
+        row = jumpCmd->beat * NOTES_PER_BEAT;
+        core->state.music.ticks = row2tick(core, track, row);
+        core->state.music.next = core->state.music.ticks + 1;
+        memset(jumpCmd, 0, sizeof(tic_jump_command));
+    }
+
+    s32 rows = MUSIC_PATTERN_ROWS - track->rows;
+    if (row >= rows)
+    {
+        row = 0;
+        core->state.music.ticks = 0;
+        core->state.music.next = 1;
+
+        // in sustain mode the channels keep playing into the next frame
+        if (!music_state->flag.music_sustain)
+        {
+            resetMusicChannels(memory);
+
+            for (s32 c = 0; c < TIC_SOUND_CHANNELS; c++)
+                setMusicChannelData(memory, -1, 0, 0, MAX_VOLUME, MAX_VOLUME, c);
+        }
+
+        if (music_state->flag.music_status == tic_music_play)
+        {
+            music_state->music.frame++;
+
+            if (music_state->music.frame >= MUSIC_FRAMES)
+            {
+                if (music_state->flag.music_loop)
+                    music_state->music.frame = 0;
+                else
+                {
+                    stopMusic(memory);
+                    return;
+                }
+            }
+            else
+            {
+                s32 val = 0;
+                for (s32 c = 0; c < TIC_SOUND_CHANNELS; c++)
+                    val += tic_tool_get_pattern_id(track, music_state->music.frame, c);
+
+                // empty frame detected
+                if (!val)
+                {
+                    if (music_state->flag.music_loop)
+                        music_state->music.frame = 0;
+                    else
+                    {
+                        stopMusic(memory);
+                        return;
+                    }
+                }
+            }
+        }
+        else if (music_state->flag.music_status == tic_music_play_frame)
+        {
+            if (!music_state->flag.music_loop)
+            {
+                stopMusic(memory);
+                return;
+            }
+        }
+    }
+
+    if (core->state.music.decoded.track != music_state->music.track
+        || core->state.music.decoded.frame != music_state->music.frame)
+        decodeFrame(memory, music_state->music.track, music_state->music.frame);
+
+    if (row != music_state->music.row)
+    {
+        music_state->music.row = row;
+
+        for (s32 c = 0; c < TIC_SOUND_CHANNELS; c++)
+        {
+            const tic_music_event* event = &core->state.music.decoded.events[c][row];
+            tic_command_data* cmdData = &core->state.music.commands[c];
+
+            if (event->command == tic_music_cmddelay)
+            {
+                cmdData->delay.active = true;
+                cmdData->delay.event = *event;
+                cmdData->delay.ticks = param2val(event);
+            }
+            else playEvent(memory, c, event);
+        }
+    }
+
+    for (s32 i = 0; i < TIC_SOUND_CHANNELS; ++i)
+    {
+        tic_channel_data* channel = &core->state.music.channels[i];
+        tic_command_data* cmdData = &core->state.music.commands[i];
+
+        if (cmdData->delay.active && cmdData->delay.ticks == 0)
+        {
+            cmdData->delay.active = false;
+            playEvent(memory, i, &cmdData->delay.event);
+        }
+
+        if (channel->index >= 0)
+        {
+            s32 note = channel->note;
+            s32 pitch = 0;
+
+            // process chord commmand
+            {
+                s32 chord[] =
+                {
+                    0,
+                    cmdData->chord.note1,
+                    cmdData->chord.note2
+                };
+
+                note += chord[cmdData->chord.tick % (cmdData->chord.note2 == 0 ? 2 : 3)];
+            }
+
+            // process vibrato commmand
+            if (cmdData->vibrato.period && cmdData->vibrato.depth)
+            {
+                static const s32 VibData[] = {0x0, 0x31f1, 0x61f8, 0x8e3a, 0xb505, 0xd4db, 0xec83, 0xfb15, 0x10000, 0xfb15, 0xec83, 0xd4db, 0xb505, 0x8e3a, 0x61f8, 0x31f1, 0x0, -0x31f1, -0x61f8, -0x8e3a, -0xb505, -0xd4db, -0xec83, -0xfb15, -0x10000, -0xfb15, -0xec83, -0xd4db, -0xb505, -0x8e3a, -0x61f8, -0x31f1};
+                static_assert(COUNT_OF(VibData) == 32, "VibData");
+
+                s32 p = cmdData->vibrato.period << 1;
+                pitch += (VibData[(cmdData->vibrato.tick % p) * COUNT_OF(VibData) / p] * cmdData->vibrato.depth) >> 16;
+            }
+
+            // process slide command
+            if (cmdData->slide.tick < cmdData->slide.duration)
+                pitch += (NoteFreqs[channel->note] - NoteFreqs[note = cmdData->slide.note]) * cmdData->slide.tick / cmdData->slide.duration;
+
+            pitch += cmdData->finepitch.value;
+
+            sfx(memory, channel->index, note, pitch, channel, &memory->ram.registers[i], i);
+        }
+
+        ++cmdData->chord.tick;
+        ++cmdData->vibrato.tick;
+        ++cmdData->slide.tick;
+
+        if (cmdData->delay.ticks)
+            cmdData->delay.ticks--;
+    }
+
+    core->state.music.ticks++;
+}
+
 //#524
 void tic_core_sound_tick_start(tic_mem* memory)
 {
@@ -208,3 +494,162 @@ void tic_core_sound_tick_start(tic_mem* memory)
             sfx(memory, c->index, c->note, 0, c, &memory->ram.registers[i], i);
     }
 }
+
+static inline s32 freq2period(s32 freq)
+{
+    enum { MinPeriodValue = 10, MaxPeriodValue = 4096, Rate = CLOCKRATE * ENVELOPE_FREQ_SCALE / WAVE_VALUES };
+
+    if (freq == 0) return MaxPeriodValue;
+
+    return CLAMP(Rate / freq - 1, MinPeriodValue, MaxPeriodValue);
+}
+
+// amplitude of every wave value at the register and stereo volume
+static void getAmps(const tic_sound_register* reg, u8 volume, s32* amps)
+{
+    enum { AmpMax = (u16)-1 / 2 };
+
+    for (s32 i = 0; i <= WAVE_MAX_VALUE; i++)
+        amps[i] = (i * volume / MAX_VOLUME * AmpMax / MAX_VOLUME) * reg->volume / MAX_VOLUME / TIC_SOUND_CHANNELS;
+}
+
+// blip_buf sums the steps, so a delta is added only where the amplitude changes
+static inline void updateAmp(blip_buffer_t* blip, tic_sound_register_data* data, s32 amp)
+{
+    if (amp != data->amp)
+    {
+        blip_add_delta(blip, data->time, amp - data->amp);
+        data->amp = amp;
+    }
+}
+
+static void runEnvelope(blip_buffer_t* blip, const tic_sound_register* reg, tic_sound_register_data* data, s32 end, const s32* amps)
+{
+    s32 period = freq2period(reg->freq * ENVELOPE_FREQ_SCALE);
+
+    for (; data->time < end; data->time += period)
+    {
+        data->phase = (data->phase + 1) % WAVE_VALUES;
+        updateAmp(blip, data, amps[tic_tool_peek4(reg->waveform.data, data->phase)]);
+    }
+}
+
+static void runNoise(blip_buffer_t* blip, const tic_sound_register* reg, tic_sound_register_data* data, s32 end, const s32* amps)
+{
+    // phase is the noise LFSR, which must never be zero
+    if (data->phase == 0)
+        data->phase = 1;
+
+    s32 period = freq2period(reg->freq);
+
+    for (; data->time < end; data->time += period)
+    {
+        data->phase = ((data->phase & 1) * 0x6000) ^ (data->phase >> 1);
+        updateAmp(blip, data, (data->phase & 1) ? amps[WAVE_MAX_VALUE] : 0);
+    }
+}
+
+// an empty waveform plays noise
+static bool isNoiseWaveform(const tic_waveform* wave)
+{
+    static const tic_waveform NoiseWave;
+    return memcmp(NoiseWave.data, wave->data, sizeof(tic_waveform)) == 0;
+}
+
+static void runChannel(blip_buffer_t* blip, const tic_sound_register* reg, tic_sound_register_data* data, s32 end, const s32* amps)
+{
+    if (isNoiseWaveform(&reg->waveform))
+        runNoise(blip, reg, data, end, amps);
+    else
+        runEnvelope(blip, reg, data, end, amps);
+}
+
+// blip_buf can't save its buffers, so a restore restarts them at the restored
+// channel amplitudes: only the band limited tail of the edges before the
+// snapshot is lost
+void tic_core_sound_restore(tic_mem* memory)
+{
+    tic_core* core = (tic_core*)memory;
+    s32 left = 0, right = 0;
+
+    for (s32 i = 0; i < TIC_SOUND_CHANNELS; ++i)
+    {
+        left += core->state.registers.left[i].amp;
+        right += core->state.registers.right[i].amp;
+    }
+
+    blip_clear(core->blip.left);
+    blip_add_delta_fast(core->blip.left, 0, left);
+
+    if (core->channels == TIC_STEREO_CHANNELS)
+    {
+        blip_clear(core->blip.right);
+        blip_add_delta_fast(core->blip.right, 0, right);
+    }
+}
+
+// widen the s16 samples to float in place, from the end as floats take more room
+static void samplesToFloat(void* buffer, s32 count)
+{
+    const s16* src = buffer;
+    float* dst = buffer;
+
+    for (s32 i = count - 1; i >= 0; i--)
+        dst[i] = src[i] / 32768.0f;
+}
+
+//#594
+void tic_core_sound_tick_end(tic_mem* memory)
+{
+    enum { EndTime = CLOCKRATE / TIC80_FRAMERATE };
+
+    tic_core* core = (tic_core*)memory;
+    tic_sound_register_data* left = core->state.registers.left;
+    tic_sound_register_data* right = core->state.registers.right;
+    bool stereo = core->channels == TIC_STEREO_CHANNELS;
+
+    for (s32 i = 0; i < TIC_SOUND_CHANNELS; ++i)
+    {
+        const tic_sound_register* reg = &memory->ram.registers[i];
+        s32 leftAmps[WAVE_MAX_VALUE + 1];
+        s32 rightAmps[WAVE_MAX_VALUE + 1];
+
+        getAmps(reg, tic_tool_peek4(&memory->ram.stereo.data, i * 2), leftAmps);
+        getAmps(reg, tic_tool_peek4(&memory->ram.stereo.data, i * 2 + 1), rightAmps);
+
+        if (stereo)
+        {
+            runChannel(core->blip.left, reg, &left[i], EndTime, leftAmps);
+            runChannel(core->blip.right, reg, &right[i], EndTime, rightAmps);
+            right[i].time -= EndTime;
+        }
+        else
+        {
+            // mono folds the stereo volumes into the left buffer
+            for (s32 a = 0; a <= WAVE_MAX_VALUE; a++)
+                leftAmps[a] = (leftAmps[a] + rightAmps[a]) / 2;
+
+            runChannel(core->blip.left, reg, &left[i], EndTime, leftAmps);
+        }
+
+        left[i].time -= EndTime;
+    }
+
+    blip_end_frame(core->blip.left, EndTime);
+
+    if (stereo)
+        blip_end_frame(core->blip.right, EndTime);
+
+    // rates that aren't a multiple of the framerate give a sample more on some ticks
+    s32 count = MIN(blip_samples_avail(core->blip.left), TIC_TICK_SAMPLES(core->samplerate));
+
+    blip_read_samples(core->blip.left, memory->samples.buffer, count, stereo);
+
+    if (stereo)
+        blip_read_samples(core->blip.right, memory->samples.buffer + 1, count, stereo);
+
+    memory->samples.size = count * core->channels * TIC80_SOUND_BYTES(core->soundFormat);
+
+    if (core->soundFormat == TIC80_SOUND_FORMAT_F32)
+        samplesToFloat(memory->samples.buffer, count * core->channels);
+}
@@ -184,6 +184,8 @@ static struct
 
 	s32	samplerate;
 	tic_font systemFont;
+
+	bool profile;
 } impl =
 {
 	.tic80local = NULL,
@@ -305,6 +307,29 @@ static void updateStudioProject()
 	}
 }
 
+// per frame min/avg/p99 of every phase in microseconds, drawn by the next blit
+static void drawProfile()
+{
+	static const char* const Phases[TIC80_PROFILE_PHASES] = {"io", "tic", "scn", "ovr", "blit", "snd"};
+
+	enum {Width = 24 * TIC_FONT_WIDTH + 2, Height = (TIC80_PROFILE_PHASES + 1) * TIC_FONT_HEIGHT + 2};
+
+	tic_mem* tic = impl.studio.tic;
+	tic80_profile_stats stats[TIC80_PROFILE_PHASES];
+
+	tic_core_profile_stats(tic, stats);
+
+	tic_api_rect(tic, 0, 0, Width, Height, tic_color_black);
+	tic_api_print(tic, "       min    avg    p99", 1, 1, tic_color_grey, true, 1, false);
+
+	for (s32 i = 0; i < TIC80_PROFILE_PHASES; i++)
+	{
+		char buf[STUDIO_TEXT_BUFFER_WIDTH + 1];
+		snprintf(buf, sizeof buf, "%-4s%6.0f %6.0f %6.0f", Phases[i], stats[i].min, stats[i].avg, stats[i].p99);
+		tic_api_print(tic, buf, 1, 1 + (i + 1) * TIC_FONT_HEIGHT, tic_color_white, true, 1, false);
+	}
+}
+
 //#1891
 static void studioTick()
 {
@@ -379,8 +404,12 @@ static void studioTick()
 		{
 			memcpy(tic->ram.vram.palette.data, getConfig()->cart->bank0.palette.scn.data, sizeof(tic_palette));
 			memcpy(tic->ram.font.data, impl.systemFont.data, sizeof(tic_font));
+			tic_core_dirty_ram(tic, offsetof(tic_ram, font), sizeof(tic_font));
 		}
 
+		if (impl.profile)
+			drawProfile();
+
 		data
 			? tic_core_blit_ex(tic, tic->screen_format, scanline, overline, data)
 			: tic_core_blit(tic, tic->screen_format);
@@ -481,7 +510,7 @@ Studio* studioInit(s32 argc, char **argv, s32 samplerate, const char* folder)
 		}
 	}
 
-	impl.tic80local = (tic80_local*)tic80_create(impl.samplerate);
+	impl.tic80local = (tic80_local*)tic80_create(impl.samplerate, TIC80_SOUND_FORMAT_S16, TIC_STEREO_CHANNELS);
 	impl.studio.tic = impl.tic80local->memory;
 
 	{
@@ -524,6 +553,9 @@ Studio* studioInit(s32 argc, char **argv, s32 samplerate, const char* folder)
 	impl.config->data.noSound = args.nosound;
 	impl.config->data.cli = args.cli;
 
+	if ((impl.profile = args.profile))
+		tic_core_profile(impl.studio.tic, true);
+
 	impl.studio.tick = studioTick;
 	impl.studio.close = studioClose;
 	impl.studio.updateProject = updateStudioProject;
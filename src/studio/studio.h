@@ -71,6 +71,7 @@
 	macro(fs,			STRING,		"=<str>",	"path to the file system folder")	\
 	macro(scale, 		INTEGER,	"=<int>", 	"main window scale")				\
 	macro(cmd,			STRING,		"=<str>",	"run commands in the console")		\
+	macro(profile,		BOOLEAN,	"",			"show the frame time profiler")		\
 	CRT_CMD_PARAM(macro)
 
 #define SHOW_TOOLTIP(FORMAT, ...)			\
@@ -91,6 +92,7 @@ typedef struct
 	char*	fs;
 	char*	cart;
 	char*	cmd;
+	bool	profile;
 
 } StartArgs;
 
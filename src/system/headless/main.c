@@ -0,0 +1,351 @@
+// MIT License
+
+// Copyright (c) 2017 Vadim Grigoruk @nesbox
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <tic80.h>
+
+#define TIC80_EXECUTABLE_NAME "amb-headless"
+#define TIC80_DEFAULT_FRAMES (TIC80_FRAMERATE * 10)
+#define TIC80_CHANNELS 2
+
+static struct
+{
+    bool quit;
+    bool error;
+} state =
+{
+    .quit = false,
+    .error = false,
+};
+
+typedef struct
+{
+    const char* cart;
+    s32 frames;
+    bool noblit;
+    const char* screen;
+    const char* audio;
+    const char* replay;
+    const char* record;
+} Args;
+
+static void onExit()
+{
+    state.quit = true;
+}
+
+static void onError(const char* info)
+{
+    fprintf(stderr, "error: %s\n", info);
+    state.error = true;
+}
+
+static void onTrace(const char* text, u8 color)
+{
+    printf("%s\n", text);
+}
+
+static double getSeconds()
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void writeU16(FILE* file, u16 value)
+{
+    u8 bytes[] = { value & 0xff, value >> 8 };
+    fwrite(bytes, sizeof bytes, 1, file);
+}
+
+static void writeU32(FILE* file, u32 value)
+{
+    writeU16(file, value & 0xffff);
+    writeU16(file, value >> 16);
+}
+
+// 16bit stereo PCM header, the sizes are patched by closeWave()
+static FILE* openWave(const char* path, s32 samplerate)
+{
+    FILE* file = fopen(path, "wb");
+
+    if (file)
+    {
+        enum { Channels = TIC80_CHANNELS, Bytes = sizeof(s16) };
+
+        fwrite("RIFF", 4, 1, file);
+        writeU32(file, 0);
+        fwrite("WAVEfmt ", 8, 1, file);
+        writeU32(file, 16);
+        writeU16(file, 1);
+        writeU16(file, Channels);
+        writeU32(file, samplerate);
+        writeU32(file, samplerate * Channels * Bytes);
+        writeU16(file, Channels * Bytes);
+        writeU16(file, Bytes * 8);
+        fwrite("data", 4, 1, file);
+        writeU32(file, 0);
+    }
+
+    return file;
+}
+
+static void writeWave(FILE* file, const s16* samples, s32 count)
+{
+    for (s32 i = 0; i < count; i++)
+        writeU16(file, (u16)samples[i]);
+}
+
+static void closeWave(FILE* file)
+{
+    enum { HeaderSize = 44 };
+
+    u32 size = (u32)ftell(file);
+
+    fseek(file, 4, SEEK_SET);
+    writeU32(file, size - 8);
+    fseek(file, HeaderSize - 4, SEEK_SET);
+    writeU32(file, size - HeaderSize);
+
+    fclose(file);
+}
+
+// binary PPM of the whole frame including the border
+static bool writeScreen(const char* path, const tic80* tic)
+{
+    FILE* file = fopen(path, "wb");
+
+    if (!file)
+        return false;
+
+    fprintf(file, "P6\n%i %i\n255\n", TIC80_FULLWIDTH, TIC80_FULLHEIGHT);
+
+    for (s32 i = 0; i < TIC80_FULLWIDTH * TIC80_FULLHEIGHT; i++)
+    {
+        // RGBA8888 keeps the channels in memory order
+        const u8* color = (const u8*)&tic->screen[i];
+        fwrite(color, 3, 1, file);
+    }
+
+    fclose(file);
+
+    return true;
+}
+
+static void* loadFile(const char* path, s32* size)
+{
+    FILE* file = fopen(path, "rb");
+
+    if (!file)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    void* data = malloc(*size);
+
+    if (data && fread(data, *size, 1, file) != 1)
+    {
+        free(data);
+        data = NULL;
+    }
+
+    fclose(file);
+
+    return data;
+}
+
+static bool writeRecording(const char* path, tic80* tic)
+{
+    s32 size = tic80_recording(tic, NULL, 0);
+
+    if (size < 0)
+    {
+        fprintf(stderr, "Error: Recording ran out of memory.\n");
+        return false;
+    }
+
+    void* recording = malloc(size);
+    FILE* file = recording ? fopen(path, "wb") : NULL;
+
+    if (file)
+    {
+        tic80_recording(tic, recording, size);
+        fwrite(recording, size, 1, file);
+        fclose(file);
+    }
+    else fprintf(stderr, "Error: Could not write %s.\n", path);
+
+    free(recording);
+
+    return file != NULL;
+}
+
+static bool parseArgs(s32 argc, char** argv, Args* args)
+{
+    for (s32 i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+
+        if (strncmp(arg, "--frames=", 9) == 0)
+            args->frames = atoi(arg + 9);
+        else if (strcmp(arg, "--noblit") == 0)
+            args->noblit = true;
+        else if (strncmp(arg, "--screen=", 9) == 0)
+            args->screen = arg + 9;
+        else if (strncmp(arg, "--audio=", 8) == 0)
+            args->audio = arg + 8;
+        else if (strncmp(arg, "--replay=", 9) == 0)
+            args->replay = arg + 9;
+        else if (strncmp(arg, "--record=", 9) == 0)
+            args->record = arg + 9;
+        else if (arg[0] == '-')
+            return false;
+        else args->cart = arg;
+    }
+
+    // a replay runs to its end unless the frames are given
+    if (args->frames < 0)
+        args->frames = args->replay ? INT32_MAX : TIC80_DEFAULT_FRAMES;
+
+    return args->cart && args->frames > 0;
+}
+
+static s32 runCart(const Args* args, void* cart, s32 size)
+{
+    tic80* tic = tic80_create(TIC80_SAMPLERATE, TIC80_SOUND_FORMAT_S16, TIC80_CHANNELS);
+
+    if (!tic)
+    {
+        fprintf(stderr, "Failed to create tic80.\n");
+        return 1;
+    }
+
+    tic->callback.exit = onExit;
+    tic->callback.error = onError;
+    tic->callback.trace = onTrace;
+    tic->screen_format = TIC80_PIXEL_COLOR_RGBA8888;
+
+    tic80_load(tic, cart, size);
+
+    s32 replaySize = 0;
+    void* replay = NULL;
+
+    if (args->replay)
+    {
+        if (!(replay = loadFile(args->replay, &replaySize)))
+        {
+            fprintf(stderr, "Error: Could not load %s.\n", args->replay);
+            tic80_delete(tic);
+            return 1;
+        }
+
+        if (!tic80_replay(tic, replay, replaySize))
+        {
+            fprintf(stderr, "Error: %s isn't a recording of this cart.\n", args->replay);
+            free(replay);
+            tic80_delete(tic);
+            return 1;
+        }
+    }
+
+    if (args->record)
+        tic80_record(tic, true);
+
+    FILE* wave = NULL;
+
+    if (args->audio && !(wave = openWave(args->audio, TIC80_SAMPLERATE)))
+        fprintf(stderr, "Error: Could not write %s.\n", args->audio);
+
+    tic80_input input;
+    memset(&input, 0, sizeof input);
+
+    s32 frame = 0;
+    double start = getSeconds();
+
+    for (; frame < args->frames && !state.quit && !state.error; frame++)
+    {
+        if (replay)
+        {
+            if (!tic80_replay_tick(tic, !args->noblit))
+                break;
+        }
+        else args->noblit
+            ? tic80_update(tic, &input)
+            : tic80_tick(tic, &input);
+
+        if (wave)
+            writeWave(wave, tic->sound.samples, tic->sound.count);
+    }
+
+    double elapsed = getSeconds() - start;
+
+    printf("%i frames in %.3f s, %.1f fps\n", frame, elapsed, elapsed > 0 ? frame / elapsed : 0);
+
+    if (wave)
+        closeWave(wave);
+
+    if (args->screen && args->noblit)
+        tic80_blit(tic);
+
+    if (args->screen && !writeScreen(args->screen, tic))
+        fprintf(stderr, "Error: Could not write %s.\n", args->screen);
+
+    bool recorded = !args->record || writeRecording(args->record, tic);
+
+    tic80_delete(tic);
+    free(replay);
+
+    return state.error || !recorded ? 1 : 0;
+}
+
+s32 main(s32 argc, char** argv)
+{
+    const char* executable = argc > 0 ? argv[0] : TIC80_EXECUTABLE_NAME;
+
+    Args args = { .frames = -1 };
+
+    if (!parseArgs(argc, argv, &args))
+    {
+        printf("Usage: %s <file> [--frames=%i] [--noblit] [--screen=<file.ppm>] [--audio=<file.wav>] [--replay=<file>] [--record=<file>]\n", executable, TIC80_DEFAULT_FRAMES);
+        return 1;
+    }
+
+    s32 size = 0;
+    void* cart = loadFile(args.cart, &size);
+
+    if (!cart)
+    {
+        fprintf(stderr, "Error: Could not load %s.\n", args.cart);
+        return 1;
+    }
+
+    s32 output = runCart(&args, cart, size);
+
+    free(cart);
+
+    return output;
+}
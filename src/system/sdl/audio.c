@@ -0,0 +1,218 @@
+// MIT License
+
+// Copyright (c) 2017 Vadim Grigoruk @nesbox
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "audio.h"
+#include "defines.h"
+
+#include <string.h>
+
+// the rate moves at most 0.5% off, about 9 cents, to steer the fill level,
+// the integral part settles on the clock difference of the two sides
+#define MAX_DRIFT 0.005
+#define DRIFT_GAIN 0.02
+#define DRIFT_INTEGRAL 0.0005
+#define FILL_SMOOTHING 0.05
+
+static u32 roundPow2(u32 value)
+{
+	u32 pow2 = 1;
+
+	while (pow2 < value)
+		pow2 <<= 1;
+
+	return pow2;
+}
+
+static void lerpFrame(const AudioRing* ring, u8* out, u32 tail, float phase)
+{
+	const u8* a = ring->buffer + (tail & ring->mask) * ring->frameSize;
+	const u8* b = ring->buffer + ((tail + 1) & ring->mask) * ring->frameSize;
+
+	if (ring->format == TIC80_SOUND_FORMAT_F32)
+	{
+		for (s32 c = 0; c < ring->spec.channels; c++)
+		{
+			float from = ((const float*)a)[c];
+			((float*)out)[c] = from + (((const float*)b)[c] - from) * phase;
+		}
+	}
+	else
+	{
+		for (s32 c = 0; c < ring->spec.channels; c++)
+		{
+			s32 from = ((const s16*)a)[c];
+			((s16*)out)[c] = from + (s32)((((const s16*)b)[c] - from) * phase);
+		}
+	}
+}
+
+static void audioCallback(void* userdata, u8* stream, s32 len)
+{
+	AudioRing* ring = userdata;
+	u8* out = stream;
+	s32 frames = len / ring->frameSize;
+
+	u32 tail = SDL_AtomicGet(&ring->tail);
+	u32 avail = SDL_AtomicGet(&ring->head) - tail;
+
+	// wait for the target latency after the start or an underrun
+	if (!ring->primed)
+	{
+		if (avail < ring->target)
+		{
+			memset(stream, 0, len);
+			return;
+		}
+
+		ring->primed = true;
+		ring->fill = avail;
+	}
+
+	ring->fill += (avail - ring->fill) * FILL_SMOOTHING;
+
+	double error = (ring->fill - ring->target) / ring->target;
+	ring->drift = CLAMP(ring->drift + error * DRIFT_INTEGRAL, -MAX_DRIFT, MAX_DRIFT);
+
+	double step = 1.0 + CLAMP(error * DRIFT_GAIN + ring->drift, -MAX_DRIFT, MAX_DRIFT);
+
+	for (s32 i = 0; i < frames; i++, out += ring->frameSize)
+	{
+		// the interpolation reads one frame past the tail
+		if (avail < 2)
+		{
+			memset(out, 0, (frames - i) * ring->frameSize);
+			SDL_AtomicAdd(&ring->underruns, 1);
+			ring->primed = false;
+			break;
+		}
+
+		lerpFrame(ring, out, tail, (float)ring->phase);
+
+		ring->phase += step;
+
+		u32 advance = (u32)ring->phase;
+		ring->phase -= advance;
+		tail += advance;
+		avail -= advance;
+	}
+
+	SDL_AtomicSet(&ring->tail, tail);
+}
+
+static bool isNative(const SDL_AudioSpec* spec)
+{
+	return (spec->format == AUDIO_S16SYS || spec->format == AUDIO_F32SYS)
+		&& (spec->channels == 1 || spec->channels == 2);
+}
+
+bool audioOpen(AudioRing* ring, s32 freq, s32 latency, bool negotiate)
+{
+	memset(ring, 0, sizeof(AudioRing));
+
+	// the device buffer adds to the latency, keep it small
+	SDL_AudioSpec want =
+	{
+		.freq = freq,
+		.format = AUDIO_S16SYS,
+		.channels = 2,
+		.samples = roundPow2(freq * latency / 1000 / 8),
+		.callback = audioCallback,
+		.userdata = ring,
+	};
+
+	ring->device = SDL_OpenAudioDevice(NULL, 0, &want, &ring->spec, negotiate
+		? SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_FORMAT_CHANGE | SDL_AUDIO_ALLOW_CHANNELS_CHANGE
+		: 0);
+
+	// the core renders only 16 bit or float mono and stereo, leave any
+	// other device format to SDL at the rate the device asked for
+	if (ring->device && !isNative(&ring->spec))
+	{
+		SDL_CloseAudioDevice(ring->device);
+
+		want.freq = ring->spec.freq;
+		want.format = SDL_AUDIO_ISFLOAT(ring->spec.format) ? AUDIO_F32SYS : AUDIO_S16SYS;
+		want.channels = ring->spec.channels == 1 ? 1 : 2;
+
+		ring->device = SDL_OpenAudioDevice(NULL, 0, &want, &ring->spec, 0);
+	}
+
+	if (!ring->device)
+		return false;
+
+	ring->format = ring->spec.format == AUDIO_F32SYS ? TIC80_SOUND_FORMAT_F32 : TIC80_SOUND_FORMAT_S16;
+	ring->frameSize = ring->spec.channels * TIC80_SOUND_BYTES(ring->format);
+
+	ring->target = MAX(ring->spec.freq * latency / 1000, 2);
+
+	// room for the target, a few ticks of jitter and the device buffer
+	u32 size = roundPow2(ring->target + ring->spec.freq / TIC80_FRAMERATE * 4 + ring->spec.samples);
+	ring->buffer = SDL_malloc(size * ring->frameSize);
+	ring->mask = size - 1;
+
+	if (!ring->buffer)
+	{
+		SDL_CloseAudioDevice(ring->device);
+		ring->device = 0;
+		return false;
+	}
+
+	SDL_PauseAudioDevice(ring->device, 0);
+
+	return true;
+}
+
+void audioWrite(AudioRing* ring, const void* samples, s32 count)
+{
+	if (!ring->buffer)
+		return;
+
+	s32 frames = count / ring->spec.channels;
+
+	u32 head = SDL_AtomicGet(&ring->head);
+	u32 space = ring->mask + 1 - (head - SDL_AtomicGet(&ring->tail));
+
+	// the consumer owns the tail, so the frames that don't fit are dropped
+	if ((u32)frames > space)
+	{
+		SDL_AtomicAdd(&ring->overruns, 1);
+		frames = space;
+	}
+
+	u32 start = head & ring->mask;
+	u32 first = MIN((u32)frames, ring->mask + 1 - start);
+
+	memcpy(ring->buffer + start * ring->frameSize, samples, first * ring->frameSize);
+	memcpy(ring->buffer, (const u8*)samples + first * ring->frameSize, (frames - first) * ring->frameSize);
+
+	SDL_AtomicSet(&ring->head, head + frames);
+}
+
+void audioClose(AudioRing* ring)
+{
+	if (ring->device)
+		SDL_CloseAudioDevice(ring->device);
+
+	SDL_free(ring->buffer);
+	memset(ring, 0, sizeof(AudioRing));
+}
@@ -0,0 +1,66 @@
+// MIT License
+
+// Copyright (c) 2017 Vadim Grigoruk @nesbox
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <SDL.h>
+#include <tic80.h>
+
+#define AUDIO_LATENCY_MS 20
+
+// Single producer / single consumer ring of interleaved sample frames.
+// The emulation thread writes whole ticks with audioWrite(), the SDL
+// callback drains it and slightly resamples to hold the fill level at
+// the target latency. The frames are in the device format, so the core
+// has to render in `format` with `spec.channels`.
+typedef struct
+{
+	SDL_AudioDeviceID device;
+	SDL_AudioSpec spec;
+	tic80_sound_format format;
+
+	u8* buffer;
+	u32 mask;
+	u32 frameSize;
+
+	// frame positions, head is moved only by the producer and tail only
+	// by the callback, both wrap around u32
+	SDL_atomic_t head;
+	SDL_atomic_t tail;
+
+	SDL_atomic_t underruns;
+	SDL_atomic_t overruns;
+
+	// owned by the callback
+	u32 target;
+	bool primed;
+	double fill;
+	double drift;
+	double phase;
+} AudioRing;
+
+// with `negotiate` the device picks the rate, format and channels,
+// otherwise SDL converts from 16 bit stereo at `freq`
+bool audioOpen(AudioRing* ring, s32 freq, s32 latency, bool negotiate);
+void audioWrite(AudioRing* ring, const void* samples, s32 count);
+void audioClose(AudioRing* ring);
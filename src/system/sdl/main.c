@@ -22,6 +22,7 @@
 
 #include "studio/system.h"
 #include "tools.h"
+#include "audio.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -96,27 +97,15 @@ static struct
 		SDL_Cursor* cursors[COUNT_OF(SystemCursors)];
 	} mouse;
 
-	struct
-	{
-		SDL_AudioSpec		spec;
-		SDL_AudioDeviceID	device;
-	} audio;
+	AudioRing audio;
 
 } platform;
 
 //#212
 static void initSound()
 {
-	SDL_AudioSpec want = 
-	{
-		.freq = TIC80_SAMPLERATE,
-		.format = AUDIO_S16,
-		.channels = TIC_STEREO_CHANNELS,
-		.userdata = NULL,
-	};
-
-	platform.audio.device = SDL_OpenAudioDevice(NULL, 0, &want, &platform.audio.spec, 0);
-
+	// the studio core runs at TIC80_SAMPLERATE, SDL converts for the device
+	audioOpen(&platform.audio, TIC80_SAMPLERATE, AUDIO_LATENCY_MS, false);
 }
 
 //#236
@@ -126,7 +115,8 @@ static void setWindowIcon()
 
 	DEFER(u32* pixels = SDL_malloc(Size * Size * sizeof(u32)), SDL_free(pixels))
 	{
-		const u32* pal = tic_tool_palette_blit(&platform.studio->config()->cart->bank0.palette.scn, platform.studio->tic->screen_format);
+		u32 pal[TIC_PALETTE_SIZE];
+		tic_tool_palette_blit(pal, &platform.studio->config()->cart->bank0.palette.scn, platform.studio->tic->screen_format);
 
 		for (s32 j = 0, index = 0; j < Size; j++)
 			for (s32 i = 0; i < Size; i++, index++)
@@ -182,6 +172,10 @@ static void gpuTick()
 	}
 
 	platform.studio->tick();
+
+	if (!platform.studio->config()->noSound)
+		audioWrite(&platform.audio, tic->samples.buffer, tic->samples.size / sizeof(s16));
+
 	renderClear(platform.gpu.renderer);
 	updateTextureBytes(platform.gpu.texture, tic->screen, TIC80_FULLWIDTH, TIC80_FULLHEIGHT);
 }
@@ -227,8 +221,6 @@ static s32 start(s32 argc, char **argv, const char* folder)
 					tic_sys_fullscreen();
 			}
 
-			SDL_PauseAudioDevice(platform.audio.device, 0);
-
 			{
 				u64 nextTick = SDL_GetPerformanceCounter();
 				const u64 Delta = SDL_GetPerformanceFrequency() / TIC80_FRAMERATE;
@@ -254,7 +246,7 @@ static s32 start(s32 argc, char **argv, const char* folder)
 				destroyGPU();
 
 				SDL_DestroyWindow(platform.window);
-				SDL_CloseAudioDevice(platform.audio.device);
+				audioClose(&platform.audio);
 
 				for (s32 i = 0; i < COUNT_OF(platform.mouse.cursors); i++)
 					SDL_FreeCursor(platform.mouse.cursors[i]);
@@ -22,9 +22,12 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <SDL2/SDL.h>
 #include <tic80.h>
 
+#include "audio.h"
+
 #define TIC80_WINDOW_SCALE 3
 #define TIC80_WINDOW_TITLE "TIC-80"
 #define TIC80_DEFAULT_CART "cart.tic"
@@ -43,7 +46,7 @@ static void onExit()
     state.quit = true;
 }
 
-s32 runCart(void* cart, s32 size)
+s32 runCart(void* cart, s32 size, const char* record, s32 latency)
 {
     SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO);
 
@@ -51,38 +54,19 @@ s32 runCart(void* cart, s32 size)
     SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
     SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STREAMING, TIC80_FULLWIDTH, TIC80_FULLHEIGHT);
 
-    SDL_AudioDeviceID audioDevice = 0;
-    SDL_AudioSpec audioSpec;
-    SDL_AudioCVT cvt;
-    bool audioStarted = false;
+    AudioRing audio;
     s32 output = 0;
 
-    {
-        SDL_AudioSpec want = 
-        {
-            .freq = TIC80_SAMPLERATE,
-            .format = AUDIO_S16,
-            .channels = 2,
-            .userdata = NULL,
-        };
-
-        audioDevice = SDL_OpenAudioDevice(NULL, 0, &want, &audioSpec, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_FORMAT_CHANGE | SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
-
-        SDL_BuildAudioCVT(&cvt, want.format, want.channels, audioSpec.freq, audioSpec.format, audioSpec.channels, audioSpec.freq);
-
-        if (cvt.needed) 
-        {
-            cvt.len = audioSpec.freq * audioSpec.channels * sizeof(s16) / TIC80_FRAMERATE;
-            cvt.buf = SDL_malloc(cvt.len * cvt.len_mult);
-        }
-    }
+    if (!audioOpen(&audio, TIC80_SAMPLERATE, latency, true))
+        fprintf(stderr, "Error: Could not open audio: %s\n", SDL_GetError());
 
     tic80_input input;
     SDL_memset(&input, 0, sizeof input);
 
-    tic80* tic = tic80_create(audioSpec.freq);
-    tic->callback.exit = onExit;
-    tic80_load(tic, cart, size);
+    // the core renders straight into the device format
+    tic80* tic = audio.device
+        ? tic80_create(audio.spec.freq, audio.format, audio.spec.channels)
+        : tic80_create(TIC80_SAMPLERATE, TIC80_SOUND_FORMAT_S16, 2);
 
     if(!tic) {
         fprintf(stderr, "Failed to load cart data.");
@@ -90,6 +74,12 @@ s32 runCart(void* cart, s32 size)
     }
     else 
     {
+        tic->callback.exit = onExit;
+        tic80_load(tic, cart, size);
+
+        if (record)
+            tic80_record(tic, true);
+
         u64 nextTick = SDL_GetPerformanceCounter();
         const u64 Delta = SDL_GetPerformanceFrequency() / TIC80_FRAMERATE;
 
@@ -144,22 +134,7 @@ s32 runCart(void* cart, s32 size)
 
             tic80_tick(tic, &input);
 
-            if (!audioStarted && audioDevice)
-                audioStarted = true;
-
-            SDL_PauseAudioDevice(audioDevice, 0);
-
-            {
-                s32 size = tic->sound.count * sizeof(tic->sound.samples[0]);
-
-                if (cvt.needed)
-                {
-                    SDL_memcpy(cvt.buf, tic->sound.samples, size);
-                    SDL_ConvertAudio(&cvt);
-                    SDL_QueueAudio(audioDevice, cvt.buf, cvt.len_cvt);
-                }
-                else SDL_QueueAudio(audioDevice, tic->sound.samples, size);
-            }
+            audioWrite(&audio, tic->sound.samples, tic->sound.count);
 
             SDL_RenderClear(renderer);
 
@@ -198,13 +173,41 @@ s32 runCart(void* cart, s32 size)
             }
         }
 
+        if (record)
+        {
+            s32 recordSize = tic80_recording(tic, NULL, 0);
+            void* recording = recordSize > 0 ? SDL_malloc(recordSize) : NULL;
+            FILE* file = recording ? fopen(record, "wb") : NULL;
+
+            if (recordSize < 0)
+                fprintf(stderr, "Error: Recording ran out of memory.\n");
+            else if (file)
+            {
+                tic80_recording(tic, recording, recordSize);
+                fwrite(recording, recordSize, 1, file);
+                fclose(file);
+            }
+            else fprintf(stderr, "Error: Could not write %s.\n", record);
+
+            SDL_free(recording);
+        }
+
         tic80_delete(tic);
     }
 
     SDL_DestroyTexture(texture);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
-    SDL_CloseAudioDevice(audioDevice);
+
+    {
+        s32 underruns = SDL_AtomicGet(&audio.underruns);
+        s32 overruns = SDL_AtomicGet(&audio.overruns);
+
+        if (underruns || overruns)
+            fprintf(stderr, "Audio: %i underruns, %i overruns.\n", underruns, overruns);
+    }
+
+    audioClose(&audio);
 
     SDL_free(cart);
     return output;
@@ -214,9 +217,19 @@ s32 main(s32 argc, char** argv)
 {
     const char* executable = argc > 0 ? argv[0] : TIC80_EXECUTABLE_NAME;
     const char* input = (argc > 1) ? argv[1] : TIC80_DEFAULT_CART;
+    const char* record = NULL;
+    s32 latency = AUDIO_LATENCY_MS;
+
+    for (s32 i = 2; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--record=", 9) == 0)
+            record = argv[i] + 9;
+        else if (strncmp(argv[i], "--latency=", 10) == 0)
+            latency = atoi(argv[i] + 10);
+    }
 
-    if (strcmp(input, "--help") == 0 || strcmp(input, "-h") == 0) {
-        printf("Usage: %s <file>\n", executable);
+    if (strcmp(input, "--help") == 0 || strcmp(input, "-h") == 0 || latency <= 0) {
+        printf("Usage: %s <file> [--record=<file>] [--latency=%i]\n", executable, AUDIO_LATENCY_MS);
         return 0;
     }
 
@@ -239,5 +252,5 @@ s32 main(s32 argc, char** argv)
         return 1;
     }
 
-    return runCart(cart, size);
+    return runCart(cart, size, record, latency);
 }
@@ -27,6 +27,27 @@
 #include "api.h"
 #include "tools.h"
 #include "cart.h"
+#include "core/core.h"
+
+#define SNAPSHOT_MAGIC 0x54534e53 // "SNST"
+#define RECORDING_MAGIC 0x52434954 // "TICR"
+
+typedef struct
+{
+    u32 magic;
+    u32 size;
+    u64 tick_counter;
+    tic_core_snapshot core;
+} Snapshot;
+
+// followed by <same><size><size bytes of input delta> entries: the previous input
+// repeats `same` frames, then the delta (if any) gives the input of the next frame
+typedef struct
+{
+    u32 magic;
+    u32 cart;
+    u32 frames;
+} RecordingHeader;
 
 static void onTrace(void* data, const char* text, u8 color)
 {
@@ -63,14 +84,30 @@ static u64 getCounter(void* data)
     return tic80->tick_counter;
 }
 
-tic80* tic80_create(s32 samplerate)
+// FNV-1a
+static u32 hashCart(const void* cart, s32 size)
+{
+    u32 hash = 2166136261u;
+
+    for (const u8 *ptr = cart, *end = ptr + size; ptr < end; ptr++)
+        hash = (hash ^ *ptr) * 16777619u;
+
+    return hash;
+}
+
+static s32 soundCount(tic80_local* tic80)
+{
+    return tic80->memory->samples.size / TIC80_SOUND_BYTES(((tic_core*)tic80->memory)->soundFormat);
+}
+
+tic80* tic80_create(s32 samplerate, tic80_sound_format format, s32 channels)
 {
     tic80_local* tic80 = malloc(sizeof(tic80_local));
 
     if (tic80) {
         memset(tic80, 0, sizeof(tic80_local));
 
-        tic80->memory = tic_core_create(samplerate);
+        tic80->memory = tic_core_create(samplerate, format, channels);
         tic80->tic.screen_format = tic80->memory->screen_format;
 
         return &tic80->tic;
@@ -84,7 +121,7 @@ TIC80_API void tic80_load(tic80* tic, void* cart, s32 size)
 {
     tic80_local* tic80 = (tic80_local*)tic;
 
-    tic80->tic.sound.count = tic80->memory->samples.size/sizeof(s16);
+    tic80->tic.sound.count = soundCount(tic80);
     tic80->tic.sound.samples = tic80->memory->samples.buffer;
 
     tic80->tic.screen = tic80->memory->screen;
@@ -105,29 +142,284 @@ TIC80_API void tic80_load(tic80* tic, void* cart, s32 size)
         tic_cart_load(&tic80->memory->cart, cart, size);
         tic_api_reset(tic80->memory);
     }
+
+    tic80->cart_hash = hashCart(cart, size);
 }
 
-TIC80_API void tic80_tick(tic80* tic, const tic80_input* input)
+static bool reserveRecord(tic80_local* tic80, s32 size)
 {
-    tic80_local* tic80 = (tic80_local*)tic;
+    if (tic80->record.size + size > tic80->record.capacity)
+    {
+        s32 capacity = MAX(tic80->record.capacity * 2, tic80->record.size + size + 1024);
+        u8* data = realloc(tic80->record.data, capacity);
+
+        if (!data)
+            return false;
+
+        tic80->record.data = data;
+        tic80->record.capacity = capacity;
+    }
+
+    return true;
+}
+
+static void recordInput(tic80_local* tic80, const tic80_input* input)
+{
+    enum { MaxEntry = 5 + 5 + sizeof(tic80_input) * 2 };
+
+    tic80->record.frames++;
+
+    if (memcmp(&tic80->record.last, input, sizeof(tic80_input)) == 0)
+    {
+        tic80->record.same++;
+        return;
+    }
+
+    u8 delta[MaxEntry];
+    s32 size = tic_tool_delta_encode(&tic80->record.last, input, sizeof(tic80_input), delta, sizeof delta);
+
+    if (size < 0 || !reserveRecord(tic80, MaxEntry))
+    {
+        // the frame is not in the recording, tic80_recording() reports the failure
+        tic80->record.frames--;
+        tic80->record.failed = true;
+        tic80->record.on = false;
+        return;
+    }
+
+    u8* out = tic80->record.data;
+    s32 pos = tic80->record.size;
+
+    pos = tic_tool_write_varint(out, pos, tic80->record.capacity, tic80->record.same);
+    pos = tic_tool_write_varint(out, pos, tic80->record.capacity, size);
+    memcpy(out + pos, delta, size);
+
+    tic80->record.size = pos + size;
+    tic80->record.same = 0;
+    tic80->record.last = *input;
+}
+
+static void tickLogic(tic80_local* tic80, const tic80_input* input)
+{
+    if (tic80->record.on)
+        recordInput(tic80, input);
 
-    tic80->memory->screen_format = tic80->tic.screen_format;
     tic80->memory->ram.input = *input;
 
     tic_core_tick_start(tic80->memory);
     tic_core_tick(tic80->memory, &tic80->tickData);
     tic_core_tick_end(tic80->memory);
 
-    tic_core_blit(tic80->memory, tic80->memory->screen_format);
+    tic80->tic.sound.count = soundCount(tic80);
+}
+
+TIC80_API void tic80_tick(tic80* tic, const tic80_input* input)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+
+    tickLogic(tic80, input);
+    tic80_blit(tic);
 
     tic80->tick_counter++;
 }
 
+TIC80_API void tic80_update(tic80* tic, const tic80_input* input)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+
+    tickLogic(tic80, input);
+
+    tic80->tick_counter++;
+}
+
+TIC80_API void tic80_blit(tic80* tic)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+
+    tic80->memory->screen_format = tic80->tic.screen_format;
+
+    tic_core_blit(tic80->memory, tic80->memory->screen_format);
+}
+
+TIC80_API s32 tic80_snapshot_size()
+{
+    return sizeof(Snapshot);
+}
+
+TIC80_API bool tic80_snapshot(tic80* tic, void* buffer)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+    Snapshot* snapshot = buffer;
+
+    memset(snapshot, 0, sizeof(Snapshot));
+
+    snapshot->magic = SNAPSHOT_MAGIC;
+    snapshot->size = sizeof(Snapshot);
+    snapshot->tick_counter = tic80->tick_counter;
+
+    return tic_core_snapshot_save(tic80->memory, &snapshot->core);
+}
+
+TIC80_API bool tic80_restore(tic80* tic, const void* buffer)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+    const Snapshot* snapshot = buffer;
+
+    if(snapshot->magic != SNAPSHOT_MAGIC || snapshot->size != sizeof(Snapshot))
+        return false;
+
+    if (!tic_core_snapshot_load(tic80->memory, &snapshot->core))
+        return false;
+
+    tic80->tick_counter = snapshot->tick_counter;
+
+    return true;
+}
+
+TIC80_API s32 tic80_snapshot_delta(const void* prev, const void* next, void* delta, s32 capacity)
+{
+    return tic_tool_delta_encode(prev, next, sizeof(Snapshot), delta, capacity);
+}
+
+TIC80_API bool tic80_snapshot_apply(void* snapshot, const void* delta, s32 size)
+{
+    return tic_tool_delta_apply(snapshot, sizeof(Snapshot), delta, size);
+}
+
+TIC80_API void tic80_record(tic80* tic, bool on)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+
+    if (on && !tic80->record.on)
+    {
+        tic80->record.size = 0;
+        tic80->record.frames = 0;
+        tic80->record.same = 0;
+        tic80->record.failed = false;
+        memset(&tic80->record.last, 0, sizeof(tic80_input));
+    }
+
+    tic80->record.on = on;
+}
+
+TIC80_API s32 tic80_recording(tic80* tic, void* buffer, s32 capacity)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+
+    if (tic80->record.failed)
+        return -1;
+
+    RecordingHeader header = { RECORDING_MAGIC, tic80->cart_hash, tic80->record.frames };
+
+    // frames repeating the last input are flushed as an entry without a delta
+    u8 tail[5 + 5];
+    s32 tailSize = 0;
+
+    if (tic80->record.same)
+    {
+        tailSize = tic_tool_write_varint(tail, tailSize, sizeof tail, tic80->record.same);
+        tailSize = tic_tool_write_varint(tail, tailSize, sizeof tail, 0);
+    }
+
+    s32 size = sizeof header + tic80->record.size + tailSize;
+
+    if (buffer && size <= capacity)
+    {
+        u8* out = buffer;
+        memcpy(out, &header, sizeof header);
+        memcpy(out += sizeof header, tic80->record.data, tic80->record.size);
+        memcpy(out + tic80->record.size, tail, tailSize);
+    }
+
+    return size;
+}
+
+TIC80_API bool tic80_replay(tic80* tic, const void* recording, s32 size)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+
+    if (tic80->record.failed)
+        return -1;
+
+    RecordingHeader header;
+
+    if (size < (s32)sizeof header)
+        return false;
+
+    memcpy(&header, recording, sizeof header);
+
+    if (header.magic != RECORDING_MAGIC || header.cart != tic80->cart_hash)
+        return false;
+
+    memset(&tic80->replay, 0, sizeof tic80->replay);
+
+    tic80->replay.data = recording;
+    tic80->replay.size = size;
+    tic80->replay.pos = sizeof header;
+
+    return true;
+}
+
+TIC80_API bool tic80_replay_tick(tic80* tic, bool blit)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+
+    while (!tic80->replay.same && !tic80->replay.deltaSize)
+    {
+        const u8* data = tic80->replay.data;
+        s32 pos = tic80->replay.pos;
+
+        if (!data || pos >= tic80->replay.size
+            || (pos = tic_tool_read_varint(data, pos, tic80->replay.size, &tic80->replay.same)) < 0
+            || (pos = tic_tool_read_varint(data, pos, tic80->replay.size, &tic80->replay.deltaSize)) < 0
+            || tic80->replay.deltaSize > (u32)(tic80->replay.size - pos))
+        {
+            tic80->replay.data = NULL;
+            return false;
+        }
+
+        tic80->replay.delta = data + pos;
+        tic80->replay.pos = pos + tic80->replay.deltaSize;
+    }
+
+    if (tic80->replay.same)
+        tic80->replay.same--;
+    else
+    {
+        if (!tic_tool_delta_apply(&tic80->replay.input, sizeof(tic80_input), tic80->replay.delta, tic80->replay.deltaSize))
+        {
+            tic80->replay.data = NULL;
+            return false;
+        }
+
+        tic80->replay.deltaSize = 0;
+    }
+
+    blit
+        ? tic80_tick(tic, &tic80->replay.input)
+        : tic80_update(tic, &tic80->replay.input);
+
+    return true;
+}
+
+TIC80_API void tic80_profile(tic80* tic, bool on)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+    tic_core_profile(tic80->memory, on);
+}
+
+TIC80_API void tic80_profile_get(tic80* tic, tic80_profile_stats* stats)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+    tic_core_profile_stats(tic80->memory, stats);
+}
 
 TIC80_API void tic80_delete(tic80* tic)
 {
     tic80_local* tic80 = (tic80_local*)tic;
 
+    free(tic80->record.data);
+
     tic_core_close(tic80->memory);
 
     free(tic80);
@@ -75,7 +75,7 @@
 #define MUSIC_PATTERNS 60
 #define MUSIC_CMD_BITS 3
 #define TRACK_PATTERN_BITS 6
-#define TRACK_PATTERN_MASK ((1 << TRAC_PATTERN_BITS) -1)
+#define TRACK_PATTERN_MASK ((1 << TRACK_PATTERN_BITS) -1)
 #define TRACK_PATTERNS_SIZE (TRACK_PATTERN_BITS * TIC_SOUND_CHANNELS / BITS_IN_BYTE)
 #define MUSIC_FRAMES 16
 #define MUSIC_TRACKS_BITS 3
@@ -134,7 +134,7 @@ typedef enum {
 typedef enum {
     tic_no_flip = 0b00,
     tic_horz_flip = 0b01,
-    itc_vert_flip = 0b10,
+    tic_vert_flip = 0b10,
 } tic_flip;
 
 typedef enum {
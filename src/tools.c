@@ -14,48 +14,37 @@ extern u8 tic_tool_peek1(const void* addr, u32 index);
 extern s32 tic_tool_sfx_pos(s32 speed, s32 ticks);
 
 //#110
-u32* tic_tool_palette_blit(const tic_palette* srcpal, tic80_pixel_color_format fmt)
-{
-	static u32 pal[TIC_PALETTE_SIZE];
+// bytes of a 32bit pixel in memory order for every output format
+#define PALETTE_FORMAT_LIST(macro)                                  \
+	macro(TIC80_PIXEL_COLOR_BGRA8888, src->b, src->g, src->r, 0xff) \
+	macro(TIC80_PIXEL_COLOR_RGBA8888, src->r, src->g, src->b, 0xff) \
+	macro(TIC80_PIXEL_COLOR_ABGR8888, 0xff, src->b, src->g, src->r) \
+	macro(TIC80_PIXEL_COLOR_ARGB8888, 0xff, src->r, src->g, src->b)
+
+#define PALETTE_BLIT_DEF(FMT, B0, B1, B2, B3)                           \
+static void palette_blit_##FMT(u32* dst, const tic_rgb* src)            \
+{                                                                       \
+	for (const tic_rgb* end = src + TIC_PALETTE_SIZE; src != end; src++) \
+	{                                                                   \
+		u8* color = (u8*)dst++;                                         \
+		color[0] = B0;                                                  \
+		color[1] = B1;                                                  \
+		color[2] = B2;                                                  \
+		color[3] = B3;                                                  \
+	}                                                                   \
+}
 
-	const tic_rgb* src = srcpal->colors;
-	const tic_rgb* end = src + TIC_PALETTE_SIZE;
-	u8* dst = (u8*)pal;
+PALETTE_FORMAT_LIST(PALETTE_BLIT_DEF)
+#undef PALETTE_BLIT_DEF
 
-	while (src != end)
+void tic_tool_palette_blit(u32* dst, const tic_palette* src, tic80_pixel_color_format fmt)
+{
+	switch (fmt)
 	{
-		switch (fmt) 
-		{
-		case TIC80_PIXEL_COLOR_BGRA8888:
-			*dst++ = src->b;
-			*dst++ = src->g;
-			*dst++ = src->r;
-			*dst++ = 0xff;
-		break;
-		case TIC80_PIXEL_COLOR_RGBA8888:
-			*dst++ = src->r;
-			*dst++ = src->g;
-			*dst++ = src->b;
-			*dst++ = 0xff;
-		break;
-		case TIC80_PIXEL_COLOR_ABGR8888:
-			*dst++ = 0xff;
-			*dst++ = src->b;
-			*dst++ = src->g;
-			*dst++ = src->r;			
-		break;
-		case TIC80_PIXEL_COLOR_ARGB8888:
-			*dst++ = 0xff;		
-			*dst++ = src->r;
-			*dst++ = src->g;
-			*dst++ = src->r;
-		break;
-		}
-		src++;
-
+#define PALETTE_BLIT_CASE(FMT, ...) case FMT: palette_blit_##FMT(dst, src->colors); break;
+		PALETTE_FORMAT_LIST(PALETTE_BLIT_CASE)
+#undef PALETTE_BLIT_CASE
 	}
-
-	return pal;
 }
 
 //#170
@@ -68,18 +57,125 @@ bool tic_tool_empty(const void* buffer, s32 size)
 	return true;
 }
 
+s32 tic_tool_write_varint(u8* dst, s32 pos, s32 capacity, u32 value)
+{
+	do
+	{
+		if (pos >= capacity)
+			return -1;
+
+		dst[pos++] = (value & 0x7f) | (value > 0x7f ? 0x80 : 0);
+		value >>= 7;
+	} while (value);
+
+	return pos;
+}
+
+s32 tic_tool_read_varint(const u8* src, s32 pos, s32 size, u32* value)
+{
+	*value = 0;
+
+	for (s32 shift = 0; shift < 32; shift += 7)
+	{
+		if (pos >= size)
+			return -1;
+
+		u8 byte = src[pos++];
+		*value |= (u32)(byte & 0x7f) << shift;
+
+		if (!(byte & 0x80))
+			return pos;
+	}
+
+	return -1;
+}
+
+// pattern ids of a frame are packed as TRACK_PATTERN_BITS per channel
+s32 tic_tool_get_pattern_id(const tic_track* track, s32 frame, s32 channel)
+{
+	u32 patternData = 0;
+	for (s32 b = 0; b < TRACK_PATTERNS_SIZE; b++)
+		patternData |= track->data[frame * TRACK_PATTERNS_SIZE + b] << (BITS_IN_BYTE * b);
+
+	return (patternData >> (channel * TRACK_PATTERN_BITS)) & TRACK_PATTERN_MASK;
+}
+
+// the delta is a list of <skip><count><count xor bytes> runs, varint encoded,
+// a literal run only ends on two equal bytes so a lone one doesn't cost a header
+s32 tic_tool_delta_encode(const void* prev, const void* next, s32 size, void* delta, s32 capacity)
+{
+	const u8* a = prev;
+	const u8* b = next;
+	u8* out = delta;
+	s32 pos = 0;
+
+	for (s32 i = 0; i < size;)
+	{
+		s32 start = i;
+
+		while (i < size && a[i] == b[i]) i++;
+
+		if (i == size)
+			break;
+
+		s32 skip = i - start;
+		start = i;
+
+		while (i < size && (a[i] != b[i] || (i + 1 < size && a[i + 1] != b[i + 1]))) i++;
+
+		s32 count = i - start;
+
+		if ((pos = tic_tool_write_varint(out, pos, capacity, skip)) < 0
+			|| (pos = tic_tool_write_varint(out, pos, capacity, count)) < 0
+			|| pos + count > capacity)
+			return -1;
+
+		for (s32 j = start; j < i; j++)
+			out[pos++] = a[j] ^ b[j];
+	}
+
+	return pos;
+}
+
+// xor is its own inverse, the same delta turns prev into next and back
+bool tic_tool_delta_apply(void* buffer, s32 size, const void* delta, s32 deltaSize)
+{
+	u8* dst = buffer;
+	const u8* src = delta;
+
+	for (s32 pos = 0, i = 0; pos < deltaSize;)
+	{
+		u32 skip, count;
+
+		if ((pos = tic_tool_read_varint(src, pos, deltaSize, &skip)) < 0
+			|| (pos = tic_tool_read_varint(src, pos, deltaSize, &count)) < 0
+			|| skip > (u32)(size - i) || count > (u32)(size - i - skip)
+			|| count > (u32)(deltaSize - pos))
+			return false;
+
+		i += skip;
+
+		for (const u8* end = src + pos + count, *ptr = src + pos; ptr < end;)
+			dst[i++] ^= *ptr++;
+
+		pos += count;
+	}
+
+	return true;
+}
+
 //#213
 const char* tic_tool_metatag(const char* code, const char* tag, const char* comment)
 {
     const char* start = NULL;
     {
-        static char format[] = "%s %s:";
+        static const char Format[] = "%s %s:";
 
-        char* tagBuffer = malloc(strlen(format) + strlen(tag));
+        char* tagBuffer = malloc(strlen(Format) + strlen(comment) + strlen(tag));
 
         if (tagBuffer)
         {
-            sprintf(tagBuffer, format, comment, tag);
+            sprintf(tagBuffer, Format, comment, tag);
             if ((start = strstr(code, tagBuffer)))
                 start += strlen(tagBuffer);
             free(tagBuffer);
@@ -73,8 +73,17 @@ inline u8 tic_tool_peek1(const void* addr, u32 index)
 #undef PEEK_N
 #undef POKE_N
 
-u32*	tic_tool_palette_blit(const tic_palette* src, tic80_pixel_color_format fmt);
+void	tic_tool_palette_blit(u32* dst, const tic_palette* src, tic80_pixel_color_format fmt);
 bool	tic_tool_empty(const void* buffer, s32 size);
 #define EMPTY(BUFFER) (tic_tool_empty((BUFFER), sizeof (BUFFER)))
 
+// 7 bits per byte varints, both return the position after the value or -1 if it doesn't fit
+s32		tic_tool_write_varint(u8* dst, s32 pos, s32 capacity, u32 value);
+s32		tic_tool_read_varint(const u8* src, s32 pos, s32 size, u32* value);
+
+s32		tic_tool_delta_encode(const void* prev, const void* next, s32 size, void* delta, s32 capacity);
+bool	tic_tool_delta_apply(void* buffer, s32 size, const void* delta, s32 deltaSize);
+
+s32		tic_tool_get_pattern_id(const tic_track* track, s32 frame, s32 channel);
+
 const char* tic_tool_metatag(const char* code, const char* tag, const char* comment);
@@ -0,0 +1,177 @@
+// MIT License
+
+// Copyright (c) 2017 Vadim Grigoruk @nesbox
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "core/core.h"
+#include "core/blit.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CANARY 0xdeadbeef
+
+enum { RowBytes = TIC80_WIDTH * TIC_PALETTE_BPP / BITS_IN_BYTE };
+
+static const tic80_pixel_color_format Formats[] =
+{
+	TIC80_PIXEL_COLOR_ARGB8888,
+	TIC80_PIXEL_COLOR_ABGR8888,
+	TIC80_PIXEL_COLOR_RGBA8888,
+	TIC80_PIXEL_COLOR_BGRA8888,
+};
+
+typedef struct
+{
+	const char* name;
+	tic_blit_row blitRow;
+} Expander;
+
+static s32 getExpanders(Expander* list)
+{
+	s32 count = 0;
+
+#if defined(TIC_BLIT_X86)
+	if (__builtin_cpu_supports("ssse3"))
+		list[count++] = (Expander){"ssse3", tic_core_blit_row_ssse3};
+
+	if (__builtin_cpu_supports("avx2"))
+		list[count++] = (Expander){"avx2", tic_core_blit_row_avx2};
+#elif defined(TIC_BLIT_NEON)
+	list[count++] = (Expander){"neon", tic_core_blit_row_neon};
+#endif
+
+	return count;
+}
+
+static void randomize(void* data, s32 size)
+{
+	for (s32 i = 0; i < size; i++)
+		((u8*)data)[i] = rand();
+}
+
+// every span start and length of a row, the odd ones included, against tic_core_blit_row_scalar
+static s32 checkSpans(const Expander* expander)
+{
+	s32 failed = 0;
+
+	for (s32 f = 0; f < COUNT_OF(Formats); f++)
+	{
+		tic_palette palette;
+		u32 pal[TIC_PALETTE_SIZE];
+		u8 row[RowBytes];
+
+		randomize(&palette, sizeof palette);
+		randomize(row, sizeof row);
+		tic_tool_palette_blit(pal, &palette, Formats[f]);
+
+		for (s32 start = 0; start < TIC80_WIDTH; start++)
+			for (s32 count = 0; start + count <= TIC80_WIDTH; count++)
+			{
+				u32 expected[TIC80_WIDTH + 1], actual[TIC80_WIDTH + 1];
+
+				for (s32 i = 0; i < COUNT_OF(expected); i++)
+					expected[i] = actual[i] = CANARY;
+
+				tic_core_blit_span(tic_core_blit_row_scalar, expected, row, start, count, pal);
+				tic_core_blit_span(expander->blitRow, actual, row, start, count, pal);
+
+				if (memcmp(expected, actual, sizeof expected) && failed++ < 10)
+					fprintf(stderr, "%s: format %x start %i count %i differs\n", expander->name, Formats[f], start, count);
+			}
+	}
+
+	return failed;
+}
+
+// the row loop tic_core_blit_ex() had before the expanders
+static void referenceBlit(tic_mem* tic, const u32* pal, u32* out)
+{
+	u32* rowPtr = out + TIC80_MARGIN_TOP * TIC80_FULLWIDTH;
+
+	for (s32 r = 0; r < TIC80_HEIGHT; r++, rowPtr += TIC80_FULLWIDTH)
+	{
+		u32* colPtr = rowPtr + TIC80_MARGIN_LEFT;
+		s32 pos = (r + tic->ram.vram.vars.offset.y + TIC80_HEIGHT) % TIC80_HEIGHT * TIC80_WIDTH >> 1;
+		u32 x = (-tic->ram.vram.vars.offset.x + TIC80_WIDTH) % TIC80_WIDTH;
+
+		for (s32 c = 0; c < TIC80_WIDTH / 2; c++)
+		{
+			u8 val = tic->ram.vram.screen.data[pos + c];
+			colPtr[x++ % TIC80_WIDTH] = pal[val & 0xf];
+			colPtr[x++ % TIC80_WIDTH] = pal[val >> 4];
+		}
+	}
+}
+
+// whole frames with every scroll offset, through the expander the CPU picks
+static s32 checkFrames(tic_mem* tic)
+{
+	static u32 expected[TIC80_FULLWIDTH * TIC80_FULLHEIGHT];
+
+	s32 failed = 0;
+
+	for (s32 offset = 0; offset < 256; offset++)
+	{
+		tic80_pixel_color_format fmt = Formats[offset % COUNT_OF(Formats)];
+		u32 pal[TIC_PALETTE_SIZE];
+
+		randomize(tic->ram.vram.screen.data, sizeof(tic_screen));
+		randomize(&tic->ram.vram.palette, sizeof(tic_palette));
+		tic->ram.vram.vars.offset.x = offset;
+		tic->ram.vram.vars.offset.y = offset * 7;
+
+		tic_core_blit_ex(tic, fmt, NULL, NULL, NULL);
+
+		memcpy(expected, tic->screen, sizeof expected);
+		tic_tool_palette_blit(pal, &tic->ram.vram.palette, fmt);
+		referenceBlit(tic, pal, expected);
+
+		if (memcmp(expected, tic->screen, sizeof expected) && failed++ < 10)
+			fprintf(stderr, "frame: format %x offset %i differs\n", fmt, offset);
+	}
+
+	return failed;
+}
+
+s32 main()
+{
+	Expander expanders[4];
+	s32 count = getExpanders(expanders);
+	s32 failed = 0;
+
+	srand(1);
+
+	for (s32 i = 0; i < count; i++)
+	{
+		failed += checkSpans(&expanders[i]);
+		printf("blit_test: %s spans checked\n", expanders[i].name);
+	}
+
+	tic_mem* tic = tic_core_create(TIC80_SAMPLERATE, TIC80_SOUND_FORMAT_S16, TIC_STEREO_CHANNELS);
+	failed += checkFrames(tic);
+	tic_core_close(tic);
+
+	printf("blit_test: %i failed\n", failed);
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,197 @@
+// MIT License
+
+// Copyright (c) 2017 Vadim Grigoruk @nesbox
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <tic80.h>
+#include "api.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { Instances = 64, Frames = 300, ChunkCode = 5 };
+
+// the cart only needs some code for the core to start the script
+static const char Code[] = "-- drawn by the C script below\n";
+
+typedef struct
+{
+    s32 id;
+    u32 screen[TIC80_FULLWIDTH * TIC80_FULLHEIGHT];
+    s16 samples[TIC80_SAMPLERATE / TIC80_FRAMERATE * 2];
+} Result;
+
+static u8 cart[4 + sizeof Code];
+static Result single[Instances];
+static Result threaded[Instances];
+
+static u32 nextRandom(tic_mem* memory)
+{
+    // the state is kept in the cart's RAM, so the instances share nothing
+    u32* seed = &memory->ram.persistent.data[0];
+    return *seed = *seed * 1103515245u + 12345u;
+}
+
+static bool initScript(tic_mem* memory, const char* code)
+{
+    // the cart has no palette, and an all black one would hide the drawing
+    for (s32 i = 0; i < TIC_PALETTE_SIZE; i++)
+        memory->ram.vram.palette.colors[i] = (tic_rgb){ i * 16, 255 - i * 16, i * 85 };
+
+    return true;
+}
+
+static void closeScript(tic_mem* memory) {}
+
+// draws, writes RAM and plays tones from the input, so every instance differs
+static void tickScript(tic_mem* memory)
+{
+    memory->ram.persistent.data[0] += memory->ram.input.gamepads.data;
+
+    tic_api_cls(memory, nextRandom(memory) % TIC_PALETTE_SIZE);
+
+    for (s32 i = 0; i < 32; i++)
+    {
+        u32 r = nextRandom(memory);
+        s32 x = r % TIC80_WIDTH, y = (r >> 8) % TIC80_HEIGHT;
+        u8 color = (r >> 16) % TIC_PALETTE_SIZE;
+
+        switch (i % 4)
+        {
+        case 0: tic_api_print(memory, "REENTRANT", x, y, color, r & 1, 1 + (r >> 1 & 1), false); break;
+        case 1: tic_api_circ(memory, x, y, r % 12, color); break;
+        case 2: tic_api_rect(memory, x, y, r % 30, r % 20, color); break;
+        default: tic_api_tri(memory, x, y, r % TIC80_WIDTH, (r >> 4) % TIC80_HEIGHT, (r >> 12) % TIC80_WIDTH, y / 2, color);
+        }
+    }
+
+    u32 r = nextRandom(memory);
+    tic_api_poke(memory, r % 0x3fc0, r >> 24);
+
+    // the core has no sfx() yet, so the tones go straight into the sound registers
+    for (s32 c = 0; c < TIC_SOUND_CHANNELS; c++)
+    {
+        tic_sound_register* reg = &memory->ram.registers[c];
+        u32 r = nextRandom(memory);
+
+        reg->freq = 100 + (r >> 8) % 2000;
+        reg->volume = r >> 28;
+        memcpy(reg->waveform.data, &r, sizeof r);
+    }
+}
+
+// stands in for the Lua backend, whose api bindings aren't implemented
+static const tic_script_config Script =
+{
+    .name           = "lua",
+    .init           = initScript,
+    .close          = closeScript,
+    .tick           = tickScript,
+    .singleComment  = "--",
+};
+
+const tic_script_config* get_lua_script_config()
+{
+    return &Script;
+}
+
+static void run(Result* result)
+{
+    tic80* tic = tic80_create(TIC80_SAMPLERATE, TIC80_SOUND_FORMAT_S16, 2);
+    tic80_load(tic, cart, sizeof cart);
+
+    tic80_input input;
+    memset(&input, 0, sizeof input);
+
+    for (s32 frame = 0; frame < Frames; frame++)
+    {
+        input.gamepads.data = result->id * 2654435761u + frame;
+        tic80_tick(tic, &input);
+    }
+
+    memcpy(result->screen, tic->screen, sizeof result->screen);
+    memcpy(result->samples, tic->sound.samples, sizeof result->samples);
+
+    tic80_delete(tic);
+}
+
+static void* runThread(void* data)
+{
+    run(data);
+    return NULL;
+}
+
+static bool isSilent(const Result* result)
+{
+    for (s32 i = 0; i < COUNT_OF(result->samples); i++)
+        if (result->samples[i])
+            return false;
+
+    return true;
+}
+
+s32 main()
+{
+    s32 size = sizeof Code - 1;
+    cart[0] = ChunkCode;
+    cart[1] = size & 0xff;
+    cart[2] = size >> 8;
+    memcpy(cart + 4, Code, size);
+
+    for (s32 i = 0; i < Instances; i++)
+    {
+        single[i].id = threaded[i].id = i;
+        run(&single[i]);
+    }
+
+    pthread_t threads[Instances];
+
+    for (s32 i = 0; i < Instances; i++)
+        pthread_create(&threads[i], NULL, runThread, &threaded[i]);
+
+    for (s32 i = 0; i < Instances; i++)
+        pthread_join(threads[i], NULL);
+
+    s32 failed = 0;
+
+    for (s32 i = 0; i < Instances; i++)
+    {
+        // instances that drew the same frame couldn't tell shared state apart
+        if ((i && memcmp(single[i].screen, single[i - 1].screen, sizeof single[i].screen) == 0)
+            || isSilent(&single[i]))
+        {
+            fprintf(stderr, "instance %i didn't draw its own frame and sound\n", i);
+            failed++;
+        }
+        else if (memcmp(single[i].screen, threaded[i].screen, sizeof single[i].screen)
+            || memcmp(single[i].samples, threaded[i].samples, sizeof single[i].samples))
+        {
+            fprintf(stderr, "instance %i differs from its single threaded run\n", i);
+            failed++;
+        }
+    }
+
+    printf("reentrancy_test: %i of %i instances failed\n", failed, Instances);
+
+    return failed ? 1 : 0;
+}
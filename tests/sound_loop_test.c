@@ -0,0 +1,71 @@
+// MIT License
+
+// Copyright (c) 2017 Vadim Grigoruk @nesbox
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "core/sound.c"
+
+#include <stdio.h>
+
+// calcLoopPos() before it was closed form, stepping through every position
+static s32 walkLoopPos(const tic_sound_loop* loop, s32 pos)
+{
+	s32 offset = 0;
+
+	if (loop->size > 0)
+	{
+		for (s32 i = 0; i < pos; i++)
+		{
+			if (offset < (loop->start + loop->size - 1))
+				offset++;
+			else offset = loop->start;
+		}
+	}
+	else offset = pos >= SFX_TICKS ? SFX_TICKS - 1 : pos;
+
+	return offset;
+}
+
+s32 main()
+{
+	enum { MinPos = -3, MaxPos = SFX_TICKS * 32 };
+
+	s32 checked = 0, failed = 0;
+
+	for (s32 start = 0; start < 16; start++)
+		for (s32 size = 0; size < 16; size++)
+		{
+			tic_sound_loop loop = { .start = start, .size = size };
+
+			for (s32 pos = MinPos; pos < MaxPos; pos++, checked++)
+			{
+				s32 expected = walkLoopPos(&loop, pos);
+				s32 actual = calcLoopPos(&loop, pos);
+
+				if (expected != actual && failed++ < 10)
+					fprintf(stderr, "start %i size %i pos %i: %i instead of %i\n", start, size, pos, actual, expected);
+			}
+		}
+
+	printf("sound_loop_test: %i of %i positions failed\n", failed, checked);
+
+	return failed ? 1 : 0;
+}